@@ -18,7 +18,33 @@ enum RayAlgorithms {
     SLABS            = 0,
     SLABS_MARCHING   = 1,
     BITMASK          = 2,
-    BITMASK_MARCHING = 3
+    BITMASK_MARCHING = 3,
+    DDA              = 4,
+    SLABS_SIMD       = 5,
+    SVO              = 6,
+    BRICKMAP         = 7,
+    DISTANCE_MARCHING = 8,
+    SUBVOXEL         = 9
+};
+
+/**
+ * Enum storing the extra benchmarks that can be run instead of the GUI.
+ */
+enum BenchModes {
+    BENCH_NONE     = 0,
+    BENCH_LAYOUT   = 1,
+    BENCH_TRACE    = 2,
+    BENCH_DISPATCH = 3,
+    BENCH_PACKET   = 4,
+    BENCH_PARSER   = 5,
+    BENCH_LOAD     = 6,
+    BENCH_LAZY     = 7,
+    BENCH_CACHE    = 8,
+    BENCH_SVO      = 9,
+    BENCH_BRICKMAP = 10,
+    BENCH_DISTANCE = 11,
+    BENCH_MORTON   = 12,
+    BENCH_SUBVOXEL = 13
 };
 
 /**
@@ -34,6 +60,19 @@ std::ostream& operator<<(std::ostream& os, const RayAlgorithms& a);
  * @return  Corresponding std::string.
  */
 std::string convert_to_string(const RayAlgorithms& a);
+/**
+ * Stream write override for a BenchModes enum item.
+ * @param   os  Output stream to write to.
+ * @param   b   BenchModes to convert to string and write.
+ * @return  The same output stream from the arguments.
+ */
+std::ostream& operator<<(std::ostream& os, const BenchModes& b);
+/**
+ * Converts a BenchModes enum item to string.
+ * @param   b   BenchModes to convert to string.
+ * @return  Corresponding std::string.
+ */
+std::string convert_to_string(const BenchModes& b);
 
 
 /**
@@ -57,6 +96,10 @@ public:
      * @note Defaults to 0 if not provided.
      */
     int section;
+    /**
+     * Loads every section of the chunk instead of a single one.
+     */
+    bool full_chunk;
     /**
      * Selects the ray shooting algorithm to use.
      */
@@ -73,6 +116,48 @@ public:
      * Enables benchmark mode.
      */
     bool benchmark;
+    /**
+     * Extra benchmark to run.
+     */
+    BenchModes bench_mode;
+    /**
+     * Records the trace of every ray in benchmark modes (always done by the GUI).
+     */
+    bool record_trace;
+    /**
+     * Amount of rays traced together by the packet benchmark (4 or 8).
+     */
+    int packet_width;
+    /**
+     * Side of the bricks of the brickmap algorithm in voxels (4 or 8).
+     */
+    int brick_size;
+    /**
+     * Amount of threads decoding the chunks of a world.
+     * @note Defaults to the amount of hardware threads.
+     */
+    int thread_count;
+    /**
+     * Keeps the sections of region files packed until a ray reads them.
+     */
+    bool lazy_sections;
+    /**
+     * Memory the chunks of a world may use in bytes, they are streamed through a cache when it is not 0.
+     * @note Given in megabytes on the command line.
+     */
+    size_t cache_budget;
+    /**
+     * Makes identical sections share their voxels once loaded.
+     */
+    bool dedup_sections;
+    /**
+     * Stores the voxels of the sections in Morton order instead of [y][z][x] order.
+     */
+    bool morton_layout;
+    /**
+     * Binary scene file to write the loaded scene to, nothing is written if empty.
+     */
+    std::string convert_path;
     /**
      * Benchmark folder to output to.
      */
@@ -0,0 +1,164 @@
+/**
+ * @file benchmark.hpp
+ */
+#ifndef __RAYCAST_BENCHMARK__
+#define __RAYCAST_BENCHMARK__
+
+#include "argparser.hpp"
+#include "scene.hpp"
+#include "world.hpp"
+#include "ray_algorithm.hpp"
+
+/**
+ * Amount of rays shot by the benchmarks.
+ */
+#define BENCHMARK_RAY_AMOUNT 10000
+/**
+ * Seed of the first ray shot by the benchmarks, ray i uses seed BENCHMARK_INITIAL_SEED+i.
+ */
+#define BENCHMARK_INITIAL_SEED 1
+/**
+ * Angle in radians between two neighbouring rays of a packet in the packet benchmark.
+ */
+#define BENCHMARK_PACKET_SPREAD 0.01
+/**
+ * Amount of times the world is loaded for each thread count in the load benchmark.
+ */
+#define BENCHMARK_LOAD_REPETITIONS 3
+/**
+ * Amount of times the rays are traced in the lazy benchmark, the first pass being the only one expanding sections.
+ */
+#define BENCHMARK_LAZY_PASSES 3
+/**
+ * Amount of times the rays are traced on each layout in the Morton benchmark.
+ */
+#define BENCHMARK_MORTON_PASSES 5
+
+/**
+ * Compares the step throughput of the flat voxel storage against the legacy nested vectors of per-voxel boxes.
+ * @note The steps of the slab algorithm are recorded once and replayed on both layouts.
+ * @param   scene   Scene to benchmark.
+ * @param   args    Program arguments (output folder, chunk name, verbosity).
+ */
+void benchmarkLayout(const SandboxScene& scene, const ArgParser& args);
+
+/**
+ * Measures the time needed to trace whole rays with RayAlgorithm::traceRay.
+ * @note Each line of the output file is: origin;direction|found;distance;voxel;box;normal;time
+ *       Instantiated in benchmark.cpp for SandboxScene and World.
+ * @param   scene       Scene to benchmark.
+ * @param   algorithm   Algorithm used to trace the rays.
+ * @param   args        Program arguments (output folder, chunk name, algorithm, verbosity).
+ */
+template<VoxelScene Scene>
+void benchmarkTrace(const Scene& scene, RayAlgorithm& algorithm, const ArgParser& args);
+
+/**
+ * Compares, for the same rays, virtual dispatch (per step and per ray) against the static traversal loop.
+ * @note Instantiated in benchmark.cpp for every algorithm, on SandboxScene and World.
+ * @param   scene       Scene to benchmark.
+ * @param   algorithm   Concrete algorithm used to trace the rays.
+ * @param   args        Program arguments (output folder, chunk name, algorithm, verbosity).
+ */
+template<typename Algorithm, VoxelScene Scene>
+void benchmarkDispatch(const Scene& scene, Algorithm& algorithm, const ArgParser& args);
+
+/**
+ * Compares packet tracing of camera-style bundles against tracing the same rays one by one with DDA.
+ * @note Each line of the output file has the same format as the trace benchmark, the time being the packet time divided by its width.
+ * @param   scene   Scene to benchmark.
+ * @param   args    Program arguments (output folder, chunk name, packet width, verbosity).
+ */
+void benchmarkPacket(const SandboxScene& scene, const ArgParser& args);
+
+/**
+ * Compares the AABB string parser str_to_aabbs against the legacy str_to_aabbvector on every shape of the block shapes file.
+ * @param   args    Program arguments (block shapes file, output folder, verbosity).
+ */
+void benchmarkParser(const ArgParser& args);
+
+/**
+ * Measures the time needed to load a world with 1 to args.thread_count decoding threads.
+ * @note Each line of the output file is: threads;milliseconds;speedup, the best of BENCHMARK_LOAD_REPETITIONS loads.
+ * @param   args    Program arguments (world path, block shapes file, thread count, output folder, verbosity).
+ */
+void benchmarkLoad(const ArgParser& args);
+
+/**
+ * Traces the same rays several times over a world on args.thread_count threads to compare the first pass, which
+ * expands the lazy sections it reaches, with the following ones.
+ * @note Each line of the output file is: pass;milliseconds;rays_per_second;sections_materialized;materialize_milliseconds;packed_sections
+ *       Instantiated in benchmark.cpp for every algorithm.
+ * @param   world       World to benchmark, loaded with --lazy to see the first touch costs.
+ * @param   algorithm   Concrete algorithm used to trace the rays, copied for every thread.
+ * @param   args        Program arguments (output folder, world name, algorithm, thread count, verbosity).
+ */
+template<typename Algorithm>
+void benchmarkLazy(const World& world, Algorithm& algorithm, const ArgParser& args);
+
+/**
+ * Traces rays over a streaming world and reports the chunk cache counters, the time spent waiting for missing chunks
+ * being measured apart from the traversal.
+ * @note The output file has a single line: budget_bytes;milliseconds;miss_milliseconds;rays_per_second;rays_per_second_without_misses;hits;misses;evictions;prefetches;prefetch_hits;resident_chunks;resident_bytes
+ *       Instantiated in benchmark.cpp for every algorithm.
+ * @param   world       World to benchmark, loaded with --cache.
+ * @param   algorithm   Concrete algorithm used to trace the rays.
+ * @param   args        Program arguments (output folder, world name, algorithm, cache budget, verbosity).
+ */
+template<typename Algorithm>
+void benchmarkCache(const World& world, Algorithm& algorithm, const ArgParser& args);
+/**
+ * Compares the sparse voxel octree traversal with DDA on the same rays, in steps per ray and rays per second.
+ * @note A step is a voxel tested or an empty region crossed at once, empty sections for DDA and empty octants for
+ *       the octree. The output file has a line per algorithm: algorithm;steps_per_ray;rays_per_second;hits, followed
+ *       by the build time and size of the octree: build_milliseconds;depth;nodes;leaves;bytes
+ *       Instantiated in benchmark.cpp for SandboxScene and World.
+ * @param   scene   Scene to benchmark.
+ * @param   args    Program arguments (output folder, chunk name, verbosity).
+ */
+template<VoxelScene Scene>
+void benchmarkSvo(const Scene& scene, const ArgParser& args);
+/**
+ * Compares the brickmap traversal with DDA on the same rays, the steps of the brickmap being split between the empty
+ * bricks crossed and the voxels stepped through inside occupied bricks.
+ * @note The output file has a line per algorithm: algorithm;steps_per_ray;brick_steps_per_ray;voxel_steps_per_ray;rays_per_second;hits,
+ *       followed by the build time and size of the brickmap: brick_size;build_milliseconds;bricks;occupied_bricks;bytes
+ *       Instantiated in benchmark.cpp for SandboxScene and World.
+ * @param   scene   Scene to benchmark.
+ * @param   args    Program arguments (output folder, chunk name, brick size, verbosity).
+ */
+template<VoxelScene Scene>
+void benchmarkBrickmap(const Scene& scene, const ArgParser& args);
+/**
+ * Compares the marching slab algorithm with a fixed step, the distance field marching and DDA on the same rays, in
+ * steps per ray and rays per second.
+ * @note The output file has a line per algorithm: algorithm;steps_per_ray;rays_per_second;hits, followed by the
+ *       build time and size of the distance field: build_milliseconds;bytes
+ *       Instantiated in benchmark.cpp for SandboxScene and World.
+ * @param   scene   Scene to benchmark.
+ * @param   args    Program arguments (output folder, chunk name, marching step, verbosity).
+ */
+template<VoxelScene Scene>
+void benchmarkDistance(const Scene& scene, const ArgParser& args);
+/**
+ * Compares the [y][z][x] and Morton voxel layouts of the sections on the same random rays, traced with the slab
+ * algorithm and DDA, in rays per second and in cache misses per ray.
+ * @note Cache misses are read from the hardware counters of the thread with perf_event_open, they are written as
+ *       -1 where the counters are not available. The output file has a line per algorithm and layout:
+ *       algorithm;layout;rays_per_second;l1d_misses_per_ray;llc_misses_per_ray;hits
+ * @param   scene   Scene to benchmark, copied in both layouts.
+ * @param   args    Program arguments (output folder, chunk name, verbosity).
+ */
+void benchmarkMorton(const SandboxScene& scene, const ArgParser& args);
+/**
+ * Compares DDA with and without the sub-voxel masks of the shapes on the same rays, in rays per second and in slab
+ * tests per ray.
+ * @note The output file has a line per algorithm: algorithm;rays_per_second;occupied_voxels_per_ray;
+ *       tested_voxels_per_ray;hits. Instantiated in benchmark.cpp for SandboxScene and World.
+ * @param   scene   Scene to benchmark.
+ * @param   args    Program arguments (output folder, chunk name, verbosity).
+ */
+template<VoxelScene Scene>
+void benchmarkSubvoxel(const Scene& scene, const ArgParser& args);
+
+#endif//__RAYCAST_BENCHMARK__
@@ -0,0 +1,168 @@
+/**
+ * @file block_shapes.hpp
+ */
+#ifndef __RAYCAST_BLOCK_SHAPES__
+#define __RAYCAST_BLOCK_SHAPES__
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <json/json.h>
+
+#include "voxel.hpp"
+#include "shape_table.hpp"
+
+/**
+ * Suffix added to the block shapes file path to get the path of its compiled cache.
+ */
+#define BLOCK_SHAPES_CACHE_SUFFIX ".cache"
+/**
+ * Bytes found at the start of every block shapes cache file.
+ */
+#define BLOCK_SHAPES_CACHE_MAGIC "RCSHAPE"
+/**
+ * Version of the cache format, bumped whenever the layout changes.
+ */
+#define BLOCK_SHAPES_CACHE_VERSION 4
+
+/**
+ * 64 bits FNV-1a hash, reading the bytes by 8 bytes words.
+ * @param   data    Bytes to hash.
+ * @param   size    Amount of bytes.
+ * @return  Hash of the bytes.
+ */
+uint64_t fnv1a(const char* data, const size_t size);
+
+/**
+ * Writes the canonical `name=value,...` string of a block property set, members being sorted by name.
+ * @note Booleans and integers are written like the strings they are read from in a region file, block property names
+ *       and values never contain `=` or `,` so that two different property sets never give the same string.
+ * @param   properties  JSON object of the properties, null if the block has none.
+ * @param   output      Set to the canonical string, empty for a null value.
+ */
+void canonicalProperties(const Json::Value& properties, std::string& output);
+
+/**
+ * Transparent string hash so that block names and property strings can be looked up from a std::string_view.
+ */
+struct BlockNameHash {
+    using is_transparent = void;
+    inline size_t operator()(std::string_view name) const {
+        return std::hash<std::string_view>()(name);
+    }
+};
+
+/**
+ * Shape of every state of a block, indexed by the canonical string of its properties.
+ */
+using BlockStates = std::unordered_map<std::string, ShapeId, BlockNameHash, std::equal_to<>>;
+
+/**
+ * Shapes of every block state, compiled from the block shapes JSON file.
+ * @note The compiled table is written next to the JSON file and reused as long as the size and modification time of the
+ *       JSON file match, or failing that the hash of its content.
+ *       Every distinct shape is stored once in a ShapeTable shared by all the scenes loaded with it.
+ */
+class BlockShapes {
+private:
+    // Attributes
+    /**
+     * Number of every block, indexed by name.
+     */
+    std::unordered_map<std::string, uint32_t, BlockNameHash, std::equal_to<>> blocks;
+    /**
+     * States of every block, indexed by block number. The empty properties string gives the first state of the block.
+     */
+    std::vector<BlockStates> states;
+    /**
+     * Amount of block states known.
+     */
+    size_t state_count;
+    /**
+     * Boxes of every distinct shape.
+     */
+    std::shared_ptr<ShapeTable> shapes;
+    /**
+     * Hash of the content of the JSON file the table was compiled from.
+     */
+    uint64_t content_hash;
+    /**
+     * Size in bytes of the JSON file.
+     */
+    uint64_t source_size;
+    /**
+     * Last modification time of the JSON file, in ticks of the filesystem clock.
+     */
+    int64_t source_mtime;
+    /**
+     * True if the table was read from the cache instead of being compiled.
+     */
+    bool from_cache;
+
+    // Methods
+    /**
+     * Builds the table from the content of a block shapes JSON file.
+     * @param   content     Content of the file.
+     */
+    void compile(const std::string& content);
+    /**
+     * Reads the table from a cache file, leaving the table empty if the cache is rejected.
+     * @param   cachePath       File location of the cache.
+     * @param   checkContent    Compares the hash of the JSON content instead of the size and modification time of the file.
+     * @return  False if the file is missing, invalid or compiled from another JSON file.
+     */
+    bool loadCache(const std::string& cachePath, const bool checkContent);
+    /**
+     * Writes the table to a cache file.
+     * @param   cachePath   File location of the cache.
+     * @return  False if the file could not be written.
+     */
+    bool saveCache(const std::string& cachePath) const;
+
+public:
+    // Constructors
+    /**
+     * Loads the shapes of a block shapes JSON file, from its cache when it is up to date.
+     * @note The JSON file is only read when its size or modification time changed since the cache was written,
+     *       the cache is (re)written when it is missing or out of date.
+     * @param   shapesPath  File location of all the blocks' AABB and properties.
+     */
+    BlockShapes(const std::string& shapesPath);
+
+    // Methods
+    /**
+     * Looks for the shape of a block state with two hash lookups, the second one on its canonical properties string.
+     * @param   name            Name of the block.
+     * @param   canonical_key   Canonical properties string of the state (see canonicalProperties), an empty string
+     *                          selects the first state of the block.
+     * @param   shape           Set to the identifier of the shape in getShapeTable if the state is found.
+     * @return  True if the state is found.
+     */
+    bool findShape(std::string_view name, std::string_view canonical_key, ShapeId& shape) const;
+    /**
+     * Getter for the table holding the shapes of every block state.
+     * @return  Shared pointer to the table.
+     */
+    inline std::shared_ptr<const ShapeTable> getShapeTable() const {
+        return shapes;
+    }
+    /**
+     * Tests if the shapes were read from the cache.
+     */
+    inline bool isFromCache() const {
+        return from_cache;
+    }
+    /**
+     * Amount of block states known.
+     */
+    inline size_t stateCount() const {
+        return state_count;
+    }
+};
+
+#endif//__RAYCAST_BLOCK_SHAPES__
@@ -0,0 +1,106 @@
+/**
+ * @file brickmap.hpp
+ */
+#ifndef __RAYCAST_BRICKMAP__
+#define __RAYCAST_BRICKMAP__
+
+#include <algorithm>
+#include <cstdint>
+
+#include "voxel.hpp"
+#include "occupancy.hpp"
+#include "scene.hpp"
+
+/**
+ * Coarse grid over a scene telling, with a single bit per brick of brick_side^3 voxels, if a brick holds any
+ * occupied voxel.
+ * @note Bricks on the far faces of the grid may stick out of the scene, the voxels outside of it are empty.
+ *       Immutable once built, it can be read by several threads.
+ */
+class Brickmap {
+private:
+    // Attributes
+    /**
+     * One bit per brick, brick (x, y, z) at ((y*bricks_z)+z)*bricks_x+x.
+     */
+    OccupancyMask bricks;
+    /**
+     * The side of a brick is 1 << shift voxels.
+     */
+    int shift;
+    /**
+     * Dimensions of the grid in bricks.
+     */
+    int bricks_x, bricks_y, bricks_z;
+
+    // Methods
+    /**
+     * Index of the bit of a brick.
+     */
+    inline size_t brickIndex(const int bx, const int by, const int bz) const {
+        return ((size_t)by*bricks_z + bz)*bricks_x + bx;
+    }
+
+public:
+    // Constructors
+    /**
+     * Builds a grid holding a single empty brick of 1 voxel.
+     */
+    Brickmap();
+    /**
+     * Builds the grid of a scene.
+     * @note Bricks inside an empty region of the scene (see findEmptyRegion) are marked empty without reading their
+     *       voxels, the voxels of the others are read until an occupied one is found.
+     *       Instantiated in brickmap.cpp for SandboxScene and World.
+     * @param   scene       Scene to build the grid of.
+     * @param   brick_side  Side of the bricks in voxels, must be a power of two.
+     */
+    template<VoxelScene Scene>
+    Brickmap(const Scene& scene, const int brick_side);
+
+    // Methods
+    /**
+     * Tests if the brick containing a voxel holds an occupied voxel.
+     * @note    The voxel must be inside the grid.
+     */
+    inline bool isBrickOccupied(const int x, const int y, const int z) const {
+        return bricks.test(brickIndex(x >> shift, y >> shift, z >> shift));
+    }
+    /**
+     * Checks if a voxel is inside the grid.
+     */
+    inline bool inBounds(const int x, const int y, const int z) const {
+        return x >= 0 && y >= 0 && z >= 0
+            && x < (bricks_x << shift) && y < (bricks_y << shift) && z < (bricks_z << shift);
+    }
+    /**
+     * Lowest and highest voxels of the brick containing a voxel.
+     */
+    inline void brickBounds(const int x, const int y, const int z, VoxelPosition& min, VoxelPosition& max) const {
+        const int low = ~((1 << shift) - 1);
+        min = VoxelPosition(x & low, y & low, z & low);
+        max = VoxelPosition(min.x + (1 << shift) - 1, min.y + (1 << shift) - 1, min.z + (1 << shift) - 1);
+    }
+    /**
+     * Side of the bricks in voxels.
+     */
+    inline int brickSide() const {
+        return 1 << shift;
+    }
+    /**
+     * Amount of bricks in the grid, and of occupied ones.
+     */
+    inline size_t brickCount() const {
+        return (size_t)bricks_x*bricks_y*bricks_z;
+    }
+    size_t occupiedBrickCount() const;
+    /**
+     * Memory used by the grid.
+     * @return  Size in bytes.
+     */
+    inline size_t memoryUsage() const {
+        return sizeof(Brickmap) + bricks.memoryUsage();
+    }
+};
+
+#endif//__RAYCAST_BRICKMAP__
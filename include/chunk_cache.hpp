@@ -0,0 +1,262 @@
+/**
+ * @file chunk_cache.hpp
+ */
+#ifndef __RAYCAST_CHUNK_CACHE__
+#define __RAYCAST_CHUNK_CACHE__
+
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "block_shapes.hpp"
+#include "scene.hpp"
+#include "region.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * Amount of chunks loaded ahead of a ray by the chunk cache, along the direction it crosses chunks.
+ */
+#define CHUNK_CACHE_PREFETCH_DISTANCE 1
+/**
+ * Maximum amount of chunks queued for prefetching, older rays are not followed when it is reached.
+ */
+#define CHUNK_CACHE_PREFETCH_QUEUE 4
+
+/**
+ * File a chunk of a streaming world is read from.
+ */
+struct ChunkSource {
+    /**
+     * Index of the file in the file list of the cache.
+     */
+    int file;
+    /**
+     * Index of the chunk in the region file, -1 for chunk JSON files.
+     */
+    int chunk;
+};
+
+/**
+ * Chunk of a streaming world known by a chunk cache, in memory or not.
+ */
+struct CachedChunk {
+    /**
+     * File the chunk is read from.
+     */
+    ChunkSource source;
+    /**
+     * Chunk once loaded, nullptr when it is not in memory.
+     */
+    std::unique_ptr<SandboxScene> chunk;
+    /**
+     * Memory used by the chunk when it was last left by a ray.
+     */
+    size_t bytes;
+    /**
+     * Position of the chunk in the LRU list while it is in memory.
+     */
+    std::list<size_t>::iterator lru_position;
+    /**
+     * Set for a chunk loaded ahead of the rays until a ray enters it.
+     */
+    bool prefetched;
+};
+
+/**
+ * Counters of a chunk cache since the world was loaded.
+ * @note Hits and misses are counted when a ray enters a chunk, not for every voxel read.
+ */
+struct ChunkCacheStats {
+    /**
+     * Chunks entered while they were in memory.
+     */
+    uint64_t hits;
+    /**
+     * Chunks entered while they were not in memory, the ray waited for them to be decoded.
+     */
+    uint64_t misses;
+    /**
+     * Chunks dropped to stay under the memory budget.
+     */
+    uint64_t evictions;
+    /**
+     * Chunks queued for loading ahead of the rays.
+     */
+    uint64_t prefetches;
+    /**
+     * Hits on chunks loaded ahead of the rays.
+     */
+    uint64_t prefetch_hits;
+    /**
+     * Time the rays waited for the chunks of the misses, in nanoseconds.
+     */
+    uint64_t miss_nanoseconds;
+    /**
+     * Chunks in memory and the memory they use, in bytes.
+     */
+    size_t resident_chunks, resident_bytes;
+};
+
+/**
+ * Chunks of a world kept in memory under a memory budget, read again from their file when needed.
+ * @note The least recently entered chunks are evicted first. When a ray crosses from a chunk to its neighbour, the
+ *       next chunks in that direction are decoded ahead by a worker thread.
+ *       Chunks are read from a single thread, only the prefetching runs in parallel.
+ */
+class ChunkCache {
+private:
+    // Attributes
+    /**
+     * Files the chunks are read from, and the mapped region files among them (nullptr for chunk JSON files).
+     */
+    std::vector<std::filesystem::path> files;
+    std::vector<std::unique_ptr<RegionFile>> regions;
+    /**
+     * AABB of every block state, must outlive the cache.
+     */
+    const BlockShapes& block_shapes;
+    /**
+     * Dimensions of the world in chunks, slot (x, z) being z*chunks_x+x.
+     */
+    int chunks_x, chunks_z;
+    /**
+     * Memory the resident chunks may use, in bytes.
+     */
+    size_t budget;
+    /**
+     * Order of the voxels of the chunks once loaded.
+     */
+    VoxelLayout voxel_layout;
+    /**
+     * Chunks holding at least one box keyed by their slot, the other slots are absent or empty.
+     * @note Only the chunks present are stored so that a sparse world does not allocate its whole bounding rectangle.
+     *       The map itself is never modified after construction, the prefetching worker reads it unlocked.
+     */
+    std::unordered_map<size_t, CachedChunk> slots;
+    /**
+     * Resident slots from the most to the least recently entered.
+     */
+    std::list<size_t> lru;
+    /**
+     * Slot of the last chunk entered, SIZE_MAX before the first one.
+     */
+    size_t last_slot;
+    /**
+     * Decoder of the chunks loaded by misses.
+     */
+    ChunkDecoder decoder;
+    /**
+     * Counters of the cache, resident_chunks and resident_bytes are kept up to date.
+     */
+    ChunkCacheStats stats;
+
+    /**
+     * Slots queued for prefetching, the slot being decoded by the worker (SIZE_MAX if none) and prefetched chunks
+     * not inserted yet, protected by prefetch_mutex.
+     * @note A queued slot removed from in_flight is skipped by the worker.
+     */
+    std::unordered_set<size_t> in_flight;
+    size_t prefetching;
+    std::unordered_map<size_t, std::unique_ptr<SandboxScene>> ready;
+    std::mutex prefetch_mutex;
+    /**
+     * Signaled when a prefetched chunk is ready.
+     */
+    std::condition_variable prefetch_done;
+    /**
+     * Decoder used by the prefetching worker only.
+     */
+    ChunkDecoder prefetch_decoder;
+    /**
+     * Worker decoding the prefetched chunks, declared last so that it stops before the rest is destroyed.
+     */
+    ThreadPool prefetcher;
+
+    // Methods
+    /**
+     * Reads and decodes a chunk from its file.
+     * @param   source          File the chunk is read from.
+     * @param   chunk_decoder   Decoder to use, owned by the calling thread.
+     * @return  The chunk, nullptr if it could not be read.
+     */
+    std::unique_ptr<SandboxScene> load(const ChunkSource& source, ChunkDecoder& chunk_decoder) const;
+    /**
+     * Stores a chunk as the most recently used one.
+     * @note The budget may be exceeded until evict is called.
+     */
+    void insert(const size_t slot, CachedChunk& cached, std::unique_ptr<SandboxScene> chunk);
+    /**
+     * Evicts the least recently used chunks until the resident ones fit the budget, the most recently used is kept.
+     */
+    void evict();
+    /**
+     * Moves the prefetched chunks that are ready into the cache.
+     */
+    void collectPrefetched();
+    /**
+     * Queues the chunks following a slot along a direction for prefetching.
+     * @param   slot    Slot just entered.
+     * @param   dx, dz  Direction of the crossing in chunks.
+     */
+    void prefetchAhead(const size_t slot, const int dx, const int dz);
+    /**
+     * Memory used by a chunk, without the shared shape table.
+     */
+    static inline size_t chunkBytes(const SandboxScene& chunk) {
+        return chunk.memoryUsage() - chunk.getShapes().memoryUsage();
+    }
+
+public:
+    // Constructors
+    /**
+     * Builds an empty cache, chunks are loaded when rays enter them.
+     * @param   files           Files the chunks are read from, region files are mapped now.
+     * @param   sources         Source of every chunk holding a box, keyed by its slot.
+     * @param   block_shapes    AABB of every block state, must outlive the cache.
+     * @param   chunks_x        Width of the world in chunks.
+     * @param   chunks_z        Depth of the world in chunks.
+     * @param   budget          Memory the resident chunks may use, in bytes. The chunk entered last is always kept.
+     * @param   lazy_sections   Keeps the sections of region files packed until a ray reads them.
+     * @param   voxel_layout    Order of the voxels of the chunks once loaded.
+     */
+    ChunkCache(std::vector<std::filesystem::path> files, const std::unordered_map<size_t, ChunkSource>& sources,
+               const BlockShapes& block_shapes, const int chunks_x, const int chunks_z, const size_t budget,
+               const bool lazy_sections, const VoxelLayout voxel_layout=VoxelLayout::ROW_MAJOR);
+    ChunkCache(const ChunkCache&) = delete;
+    ChunkCache& operator=(const ChunkCache&) = delete;
+
+    // Methods
+    /**
+     * Getter for the chunk of a slot, loaded from its file if it is not in memory.
+     * @note Only called when a ray enters another chunk, the pointer is valid until the next call.
+     * @param   slot    Slot of the chunk, z*chunks_x+x.
+     * @return  The chunk, nullptr if it is absent or empty.
+     */
+    const SandboxScene* fetch(const size_t slot);
+    /**
+     * Counters of the cache.
+     */
+    inline const ChunkCacheStats& getStats() const {
+        return stats;
+    }
+    /**
+     * Amount of chunks holding at least one box in the world, in memory or not.
+     */
+    size_t chunkCount() const;
+    /**
+     * Calls f on every chunk in memory.
+     */
+    template<typename F>
+    void forEachResident(F&& f) const {
+        for (const size_t slot : lru)
+            f(*slots.find(slot)->second.chunk);
+    }
+};
+
+#endif//__RAYCAST_CHUNK_CACHE__
@@ -0,0 +1,66 @@
+/**
+ * @file distance_field.hpp
+ */
+#ifndef __RAYCAST_DISTANCE_FIELD__
+#define __RAYCAST_DISTANCE_FIELD__
+
+#include <cstdint>
+
+#include "voxel.hpp"
+#include "lattice.hpp"
+#include "scene.hpp"
+
+/**
+ * Largest distance stored in a distance field, farther voxels keep this value.
+ */
+#define DISTANCE_FIELD_MAX 255
+
+/**
+ * Chebyshev (L-infinity) distance from every voxel of a scene to the nearest occupied voxel.
+ * @note A voxel at distance d > 0 is the center of a cube of (2d-1)^3 empty voxels. Occupied voxels are at
+ *       distance 0, voxels outside of the scene are empty.
+ *       Immutable once built, it can be read by several threads.
+ */
+class DistanceField {
+private:
+    // Attributes
+    /**
+     * Distance of every voxel in voxels, capped to DISTANCE_FIELD_MAX.
+     */
+    FlatLattice3D<uint8_t> distances;
+
+public:
+    // Constructors
+    /**
+     * Builds a field of a single voxel at the maximal distance.
+     */
+    DistanceField();
+    /**
+     * Computes the field of a scene with a forward and a backward chamfer pass over the 26 neighbours of every voxel,
+     * which is exact for the Chebyshev distance.
+     * @note Blocks of SECTION_SIDE_SIZE^3 voxels inside an empty region of the scene (see findEmptyRegion) are not
+     *       read. Instantiated in distance_field.cpp for SandboxScene and World.
+     * @param   scene   Scene to compute the field of.
+     */
+    template<VoxelScene Scene>
+    explicit DistanceField(const Scene& scene);
+
+    // Methods
+    /**
+     * Getter for the distance of a voxel to the nearest occupied voxel.
+     * @note    The voxel must be inside the scene.
+     * @return  Distance in voxels, 0 for an occupied voxel.
+     */
+    inline int distance(const VoxelPosition& p) const {
+        return distances.at(p.x, p.y, p.z);
+    }
+    /**
+     * Memory used by the field.
+     * @return  Size in bytes.
+     */
+    inline size_t memoryUsage() const {
+        return sizeof(DistanceField) + distances.size()*sizeof(uint8_t);
+    }
+};
+
+#endif//__RAYCAST_DISTANCE_FIELD__
@@ -0,0 +1,144 @@
+/**
+ * @file lattice.hpp
+ */
+#ifndef __RAYCAST_LATTICE__
+#define __RAYCAST_LATTICE__
+
+#include <vector>
+#include <new>
+#include <cstddef>
+
+/**
+ * Size in bytes of a cache line, used to align the voxel storage.
+ */
+#define CACHE_LINE_SIZE 64
+
+/**
+ * Minimal allocator returning memory aligned on a given boundary.
+ * @note Used so that the first voxel of a lattice starts on a cache line.
+ */
+template<typename T, std::size_t Alignment=CACHE_LINE_SIZE>
+struct AlignedAllocator {
+    using value_type = T;
+
+    /**
+     * Rebind helper required by the standard containers.
+     */
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    // Constructors
+    AlignedAllocator() noexcept = default;
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    // Methods
+    /**
+     * Allocates n objects of type T on an aligned boundary.
+     * @param   n   Amount of objects to allocate.
+     * @return  Pointer to the aligned memory.
+     */
+    T* allocate(const std::size_t n) {
+        return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t(Alignment)));
+    }
+    /**
+     * Frees memory previously returned by allocate.
+     * @param   p   Pointer to free.
+     */
+    void deallocate(T* p, const std::size_t) noexcept {
+        ::operator delete(p, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+/**
+ * Contiguous 3D storage indexed by computed offsets.
+ * @note Elements are stored in [y][z][x] order to match the Minecraft section data layout.
+ */
+template<typename T>
+class FlatLattice3D {
+private:
+    // Attributes
+    /**
+     * Dimensions of the lattice.
+     */
+    int size_x, size_y, size_z;
+    /**
+     * Cache line aligned storage of size_x*size_y*size_z elements.
+     */
+    std::vector<T, AlignedAllocator<T>> data;
+
+public:
+    // Constructors
+    /**
+     * Default constructor building an empty lattice.
+     */
+    FlatLattice3D() : size_x(0), size_y(0), size_z(0), data() {}
+    /**
+     * Constructs a lattice filled with copies of a value.
+     * @param   x       Size along the x axis.
+     * @param   y       Size along the y axis.
+     * @param   z       Size along the z axis.
+     * @param   value   Value to fill the lattice with.
+     */
+    FlatLattice3D(const int x, const int y, const int z, const T& value=T())
+        : size_x(x), size_y(y), size_z(z), data((std::size_t)x*y*z, value) {}
+
+    // Methods
+    /**
+     * Computes the offset of a cell in the underlying storage.
+     * @note    No bounds checks are done.
+     * @return  Index in the contiguous array.
+     */
+    inline std::size_t index(const int x, const int y, const int z) const {
+        return ((std::size_t)y*size_z + z)*size_x + x;
+    }
+    /**
+     * Cell accessor.
+     * @return  A const reference to the cell.
+     */
+    inline const T& at(const int x, const int y, const int z) const {
+        return data[index(x, y, z)];
+    }
+    /**
+     * Cell accessor.
+     * @note    This version returns a mutable reference!
+     * @return  A reference to the cell.
+     */
+    inline T& at(const int x, const int y, const int z) {
+        return data[index(x, y, z)];
+    }
+    /**
+     * Getters for the dimensions of the lattice.
+     */
+    inline int sizeX() const { return size_x; }
+    inline int sizeY() const { return size_y; }
+    inline int sizeZ() const { return size_z; }
+    /**
+     * Total amount of cells.
+     */
+    inline std::size_t size() const {
+        return data.size();
+    }
+    /**
+     * Raw pointer to the first cell.
+     */
+    inline const T* raw() const {
+        return data.data();
+    }
+    /**
+     * Raw pointer to the first cell.
+     * @note    This version returns a mutable pointer!
+     */
+    inline T* raw() {
+        return data.data();
+    }
+};
+
+#endif//__RAYCAST_LATTICE__
@@ -0,0 +1,50 @@
+/**
+ * @file morton.hpp
+ */
+#ifndef __RAYCAST_MORTON__
+#define __RAYCAST_MORTON__
+
+#include <cstdint>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+/**
+ * Name of the instruction set used to interleave the bits of Morton codes, for benchmark outputs.
+ */
+#if defined(__BMI2__)
+#define MORTON_INSTRUCTION_SET "bmi2"
+#else
+#define MORTON_INSTRUCTION_SET "scalar"
+#endif
+
+/**
+ * Spreads the 10 lowest bits of a value so that its bit i ends up in the bit 3i.
+ * @param   v   Value to spread, higher bits are ignored.
+ * @return  Value with two zero bits between each of its bits.
+ */
+inline uint32_t mortonSpread(uint32_t v) {
+    v &= 0x3ff;
+    v = (v | (v << 16)) & 0x030000ff;
+    v = (v | (v << 8)) & 0x0300f00f;
+    v = (v | (v << 4)) & 0x030c30c3;
+    v = (v | (v << 2)) & 0x09249249;
+    return v;
+}
+
+/**
+ * Morton code (Z-order curve) of a position, interleaving the bits of x, z and y starting from the lowest ones.
+ * @note Coordinates must fit in 10 bits. The x axis is the fastest varying one, like in the [y][z][x] order.
+ *       Uses the BMI2 pdep instruction when the target supports it, shifts and masks otherwise.
+ * @return  Index of the position along the curve.
+ */
+inline uint32_t mortonEncode(const uint32_t x, const uint32_t y, const uint32_t z) {
+#if defined(__BMI2__)
+    return _pdep_u32(x, 0x09249249) | _pdep_u32(z, 0x12492492) | _pdep_u32(y, 0x24924924);
+#else
+    return mortonSpread(x) | (mortonSpread(z) << 1) | (mortonSpread(y) << 2);
+#endif
+}
+
+#endif//__RAYCAST_MORTON__
@@ -0,0 +1,97 @@
+/**
+ * @file occupancy.hpp
+ */
+#ifndef __RAYCAST_OCCUPANCY__
+#define __RAYCAST_OCCUPANCY__
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#include "lattice.hpp"
+
+/**
+ * Bit set storing one bit per voxel, set when the voxel contains at least one AABB.
+ * @note A 16x16x16 section uses 4096 bits, i.e. 64 words or 8 cache lines.
+ */
+class OccupancyMask {
+private:
+    // Attributes
+    /**
+     * Bits packed in 64 bits words, bit i is stored in words[i/64].
+     */
+    std::vector<uint64_t, AlignedAllocator<uint64_t>> words;
+
+public:
+    // Constructors
+    /**
+     * Default constructor building an empty mask.
+     */
+    OccupancyMask() : words() {}
+    /**
+     * Builds a mask of a given amount of bits, all cleared.
+     * @param   bits    Amount of bits to store.
+     */
+    OccupancyMask(const size_t bits) : words((bits+63)/64, 0) {}
+
+    // Methods
+    /**
+     * Tests a bit of the mask.
+     * @note    No checks are done on the value of i.
+     * @param   i   Index of the bit.
+     * @return  True if the bit is set.
+     */
+    inline bool test(const size_t i) const {
+        return (words[i >> 6] >> (i & 63)) & 1;
+    }
+    /**
+     * Sets or clears a bit of the mask.
+     * @param   i       Index of the bit.
+     * @param   value   Value to give to the bit.
+     */
+    inline void set(const size_t i, const bool value) {
+        const uint64_t bit = (uint64_t)1 << (i & 63);
+        if (value)
+            words[i >> 6] |= bit;
+        else
+            words[i >> 6] &= ~bit;
+    }
+    /**
+     * Tests if no bit is set.
+     * @return  True if the mask is empty.
+     */
+    inline bool none() const {
+        for (const uint64_t w : words)
+            if (w)
+                return false;
+        return true;
+    }
+    /**
+     * Amount of 64 bits words used to store the bits.
+     */
+    inline size_t wordCount() const {
+        return words.size();
+    }
+    /**
+     * Raw pointer to the first word.
+     */
+    inline const uint64_t* raw() const {
+        return words.data();
+    }
+    /**
+     * Raw pointer to the first word.
+     * @note    This version returns a mutable pointer!
+     */
+    inline uint64_t* raw() {
+        return words.data();
+    }
+    /**
+     * Memory used by the bits.
+     * @return  Size in bytes.
+     */
+    inline size_t memoryUsage() const {
+        return words.size()*sizeof(uint64_t);
+    }
+};
+
+#endif//__RAYCAST_OCCUPANCY__
@@ -0,0 +1,158 @@
+/**
+ * @file octree.hpp
+ */
+#ifndef __RAYCAST_OCTREE__
+#define __RAYCAST_OCTREE__
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "voxel.hpp"
+#include "shape_table.hpp"
+#include "scene.hpp"
+
+/**
+ * Inner node of a sparse voxel octree.
+ * @note An octant is either empty, a leaf when all its voxels have the same shape, or a child node. The children and
+ *       the leaves of a node are stored next to each other, in the order of their octant. Octant i covers the half
+ *       (i&1) along x, (i>>1)&1 along y and (i>>2)&1 along z.
+ */
+struct SvoNode {
+    /**
+     * Index of the first child in the nodes of the octree, and of the first leaf in its leaves.
+     */
+    uint32_t first_child, first_leaf;
+    /**
+     * Bit i set if the octant i is a child node, or a leaf.
+     */
+    uint8_t child_mask, leaf_mask;
+};
+
+/**
+ * Sparse voxel octree built from the occupancy of a scene, empty octants are not stored.
+ * @note The octree is a cube whose side is the smallest power of two holding the scene, voxels outside of the scene
+ *       are empty. Its leaves are the shape identifiers of the octants whose voxels all have the same shape, in
+ *       the shape table of the scene.
+ *       Immutable once built, it can be read by several threads.
+ */
+class SparseVoxelOctree {
+private:
+    // Attributes
+    /**
+     * Nodes of the octree, children before their parent.
+     */
+    std::vector<SvoNode> nodes;
+    /**
+     * Shape of every voxel of the leaves.
+     */
+    std::vector<ShapeId> leaves;
+    /**
+     * Index of the root in nodes.
+     */
+    uint32_t root;
+    /**
+     * The side of the octree is 1 << levels voxels.
+     */
+    int levels;
+    /**
+     * Dimensions of the scene the octree was built from, in voxels.
+     */
+    int size_x, size_y, size_z;
+
+    // Methods
+    /**
+     * Kind of the cube covered by an octant.
+     */
+    enum class Octant {
+        EMPTY,
+        UNIFORM,
+        MIXED
+    };
+    /**
+     * Builds the node covering a cube of the scene, its descendants being appended to nodes and leaves.
+     * @param   scene   Scene to read.
+     * @param   level   The side of the cube is 1 << level voxels, 0 for a single voxel.
+     * @param   corner  Lowest voxel of the cube.
+     * @param   node    Set to the node of a mixed cube.
+     * @param   shape   Set to the shape of every voxel of a uniform cube.
+     * @return  Kind of the cube, nothing is stored for empty and uniform cubes.
+     */
+    template<VoxelScene Scene>
+    Octant buildNode(const Scene& scene, const int level, const VoxelPosition& corner, SvoNode& node, ShapeId& shape);
+
+public:
+    // Constructors
+    /**
+     * Builds an octree holding a single empty voxel.
+     */
+    SparseVoxelOctree();
+    /**
+     * Builds the octree of a scene.
+     * @note Cubes covered by an empty region of the scene (see findEmptyRegion) are skipped without reading their
+     *       voxels, every other voxel is read once. Lazy sections are expanded and the chunks of a streaming world
+     *       are all read.
+     *       Instantiated in octree.cpp for SandboxScene and World.
+     * @param   scene   Scene to build the octree of.
+     */
+    template<VoxelScene Scene>
+    explicit SparseVoxelOctree(const Scene& scene);
+
+    // Methods
+    /**
+     * Looks for the voxel containing a position in the octree.
+     * @note    The position must be inside the scene.
+     * @param   position    Voxel to look for.
+     * @param   shape       Set to the shape of the voxel if it is occupied, read from the leaf containing it.
+     * @param   min         Set to the lowest voxel of the largest empty cube containing the voxel otherwise.
+     * @param   max         Set to its highest voxel, both are clamped to the scene.
+     * @return  True if the voxel is occupied.
+     */
+    inline bool lookup(const VoxelPosition& position, ShapeId& shape, VoxelPosition& min, VoxelPosition& max) const {
+        uint32_t node = root;
+        for (int level=levels-1; ; --level) {
+            const SvoNode& n = nodes[node];
+            const int octant = ((position.x >> level) & 1) | ((position.y >> level) & 1) << 1
+                             | ((position.z >> level) & 1) << 2;
+            const unsigned below = (1u << octant) - 1;
+            if ((n.leaf_mask >> octant) & 1) {
+                shape = leaves[n.first_leaf + std::popcount(n.leaf_mask & below)];
+                return true;
+            }
+            if (!((n.child_mask >> octant) & 1)) {
+                const int low = ~((1 << level) - 1);
+                min = VoxelPosition(position.x & low, position.y & low, position.z & low);
+                max = VoxelPosition(std::min(min.x + (1 << level), size_x) - 1,
+                                    std::min(min.y + (1 << level), size_y) - 1,
+                                    std::min(min.z + (1 << level), size_z) - 1);
+                return false;
+            }
+            node = n.first_child + std::popcount(n.child_mask & below);
+        }
+    }
+    /**
+     * Amount of levels below the root, the side of the octree being 1 << depth() voxels.
+     */
+    inline int depth() const {
+        return levels;
+    }
+    /**
+     * Amount of inner nodes and of leaves.
+     */
+    inline size_t nodeCount() const {
+        return nodes.size();
+    }
+    inline size_t leafCount() const {
+        return leaves.size();
+    }
+    /**
+     * Memory used by the octree.
+     * @return  Size in bytes.
+     */
+    inline size_t memoryUsage() const {
+        return sizeof(SparseVoxelOctree) + nodes.capacity()*sizeof(SvoNode) + leaves.capacity()*sizeof(ShapeId);
+    }
+};
+
+#endif//__RAYCAST_OCTREE__
@@ -0,0 +1,91 @@
+/**
+ * @file packet.hpp
+ */
+#ifndef __RAYCAST_PACKET__
+#define __RAYCAST_PACKET__
+
+#include <cstddef>
+#include <span>
+
+#include "ray.hpp"
+#include "scene.hpp"
+#include "ray_algorithm.hpp"
+
+/**
+ * Traces packets of coherent rays together, one ray per SIMD lane.
+ * @note Every lane walks the grid with its own DDA state, the lanes standing in the same
+ *       voxel share a single fetch of its boxes which are then tested against all of them at once.
+ * @tparam  Width   Amount of rays in a packet, 4 or 8.
+ */
+template<int Width>
+class PacketTracer {
+    static_assert(Width == 4 || Width == 8, "A packet is made of 4 or 8 rays");
+
+private:
+    // Attributes, every array is stored as [axis][lane]
+    /**
+     * Origins of the rays.
+     */
+    alignas(CACHE_LINE_SIZE) double origin[3][Width];
+    /**
+     * Directions of the rays.
+     */
+    alignas(CACHE_LINE_SIZE) double direction[3][Width];
+    /**
+     * Component-wise inverses of the directions.
+     */
+    alignas(CACHE_LINE_SIZE) double inv_direction[3][Width];
+    /**
+     * Distance along each ray to the next boundary on each axis.
+     */
+    alignas(CACHE_LINE_SIZE) double t_max[3][Width];
+    /**
+     * Distance along each ray between two boundaries on each axis.
+     */
+    alignas(CACHE_LINE_SIZE) double t_delta[3][Width];
+    /**
+     * Voxel currently traversed by each ray.
+     */
+    int cell[3][Width];
+    /**
+     * Direction of the steps on each axis (-1, 0 or 1).
+     */
+    int cell_step[3][Width];
+    /**
+     * Amount of voxel fetches since the tracer was created.
+     */
+    size_t fetches;
+
+    // Methods
+    /**
+     * Loads the rays in the lanes and computes their initial DDA state.
+     * @param   rays    Rays of the packet.
+     */
+    void initialize(std::span<const Ray, Width> rays);
+
+public:
+    // Constructors
+    /**
+     * Default constructor.
+     */
+    PacketTracer() : fetches(0) {}
+
+    // Methods
+    /**
+     * Traces a packet of rays until each one hits a box or leaves the scene.
+     * @note The hits are the same as the ones of DDAAlgorithm::traceRay for each ray.
+     * @param   rays    Rays of the packet, their trace is left untouched.
+     * @param   scene   Voxel scene to use to check for intersections.
+     * @param   hits    Set to the hit of every ray, in the same order.
+     */
+    void tracePacket(std::span<const Ray, Width> rays, const SandboxScene& scene, std::span<Hit, Width> hits);
+    /**
+     * Getter for the amount of voxel fetches done, one per distinct occupied voxel per packet step.
+     * @return  Amount of fetches since the tracer was created.
+     */
+    inline size_t getFetchCount() const {
+        return fetches;
+    }
+};
+
+#endif//__RAYCAST_PACKET__
@@ -21,8 +21,20 @@ private:
      */
     Point direction;
     /**
-     * Trace of Points occuring when shooting the ray.
-     * @note Might not be a good idea for all ray shooting algorithms.
+     * Last point reached when shooting the ray.
+     */
+    Point head;
+    /**
+     * Amount of points added since the ray was (re)started.
+     */
+    unsigned int steps;
+    /**
+     * Enables the recording of every point in the trace.
+     * @note Only needed by the GUI or for debugging, batch tracing only uses the head.
+     */
+    bool record_trace;
+    /**
+     * Trace of Points occuring when shooting the ray, empty unless record_trace is set.
      */
     std::vector<Point> trace;
 
@@ -32,16 +44,22 @@ public:
      * Basic constructor.
      * @param   ori     Point of origin of the ray.
      * @param   dir     Direction of the ray, should be a normalized point.
+     * @param   record  Records every point of the trace if set, otherwise only the head is kept.
      */
-    Ray(const Point& ori, const Point& dir) : origin(ori), direction(dir), trace(1, ori) {}
+    Ray(const Point& ori, const Point& dir, const bool record=false)
+        : origin(ori), direction(dir), head(ori), steps(0), record_trace(record),
+          trace(record ? 1 : 0, ori) {}
 
     // Methods
     /**
-     * Adds a point to the trace.
+     * Moves the head of the ray, the point is added to the trace if it is recorded.
      * @param   p   Point to add.
      */
     inline void addTrace(const Point& p) {
-        trace.emplace_back(p);
+        head = p;
+        ++steps;
+        if (record_trace)
+            trace.emplace_back(p);
     }
     /**
      * Getter for the trace.
@@ -63,14 +81,38 @@ public:
      * @return  A copy of the last point of the trace.
      */
     inline Point getLastTracePoint() const {
-        return trace.back();
+        return head;
+    }
+    /**
+     * Getter for the amount of points added since the ray was (re)started.
+     * @return  0 for a ray that has not been stepped yet.
+     */
+    inline unsigned int getStepCount() const {
+        return steps;
+    }
+    /**
+     * Tests if the trace is recorded.
+     */
+    inline bool isTraceRecorded() const {
+        return record_trace;
+    }
+    /**
+     * Enables or disables the recording of the trace, then clears it.
+     * @param   record  New recording state.
+     */
+    inline void setTraceRecording(const bool record) {
+        record_trace = record;
+        clearTrace();
     }
     /**
      * Clears the trace completely and reinitializes it with the origin Point.
      */
     inline void clearTrace() {
+        head = origin;
+        steps = 0;
         trace.clear();
-        trace.emplace_back(origin);
+        if (record_trace)
+            trace.emplace_back(origin);
     }
     /**
      * Getter for the origin point of the ray.
@@ -98,8 +140,9 @@ public:
      * Resets the ray by generating new random coordinates and direction.
      * @note Random coordinates are within the Voxel scene
      * @param   seed    Pseudorandom generator seed, random seed set if 0.
+     * @param   extent  Dimensions of the scene, see SandboxScene::extent.
      */
-    void reset(const int seed=0);
+    void reset(const int seed=0, const Point& extent=Point(CHUNK_SIDE_SIZE, CHUNK_SIDE_SIZE, CHUNK_SIDE_SIZE));
 };
 
 #endif//__RAYCAST_RAY__
@@ -4,45 +4,159 @@
 #ifndef __RAYCAST_RAY_ALGORITHM__
 #define __RAYCAST_RAY_ALGORITHM__
 
+#include <memory>
+
 #include "ray.hpp"
 #include "scene.hpp"
+#include "world.hpp"
 #include "geometry.hpp"
+#include "octree.hpp"
+#include "brickmap.hpp"
+#include "distance_field.hpp"
+
+/**
+ * Distance a ray is moved along its direction past its last point, to find the voxel it is entering or to leave the
+ * scene when that point is rounded back onto its border.
+ */
+#define RAY_NUDGE 1e-5
+
+/**
+ * Slab test between a ray and a single AABB.
+ * @note The origin must be expressed in the frame of the voxel containing the box.
+ * @param   origin      Origin of the ray relative to the voxel.
+ * @param   direction   Normalized direction of the ray.
+ * @param   box         Bounding box to test.
+ * @param   distance    Set to the distance to the box along the ray if it is hit.
+ * @return  True if the box is hit.
+ */
+bool slabsRayHitsBox(const Point& origin, const Point& direction, const AABB& box, double& distance);
 
 
+/**
+ * Result of the traversal of a whole ray.
+ */
+struct Hit {
+    // Attributes
+    /**
+     * True if an AABB was hit.
+     */
+    bool found;
+    /**
+     * Distance along the ray from its origin to the hit point.
+     */
+    double distance;
+    /**
+     * Voxel containing the hit AABB.
+     */
+    VoxelPosition voxel;
+    /**
+     * Index of the hit AABB in the shape of the voxel, -1 if nothing was hit.
+     */
+    int box;
+    /**
+     * Normal of the face of the AABB that was hit.
+     */
+    Point normal;
+
+    // Constructors
+    /**
+     * Default constructor building a miss.
+     */
+    Hit() : found(false), distance(HUGE_VAL), voxel(-1, -1, -1), box(-1), normal() {}
+};
+
+/**
+ * Fills the distance and face normal of a hit once its voxel and box are known.
+ * @note Instantiated in ray_algorithm.cpp for SandboxScene and World.
+ * @param   hit         Hit to complete, voxel and box must be set.
+ * @param   origin      Origin of the ray.
+ * @param   direction   Normalized direction of the ray.
+ * @param   hit_point   Point where the ray enters the hit box.
+ * @param   scene       Scene containing the hit box.
+ */
+template<VoxelScene Scene>
+void finalizeHit(Hit& hit, const Point& origin, const Point& direction, const Point& hit_point, const Scene& scene);
+
 /**
  * Mother class for the ray algorithms used to compute a step for a given ray
  */
 class RayAlgorithm {
 public:
+    /**
+     * Algorithms are owned through base class pointers.
+     */
+    virtual ~RayAlgorithm() = default;
     /**
      * Call function used when we want to do a step of the algorithm
-     * @note VIRTUAL PURE FUNCTIONS ARE BAD FOR PERFORMANCE IN C++, try to find a substitute later
+     * @note One virtual call per step, prefer traceRayStatic when only the hit is needed
      * @param   ray     Ray to continue
      * @param   scene   Voxel scene to use to check for intersections
      * @return  True if an intersection was found
      */
     virtual bool computeStep(Ray& ray, const SandboxScene& scene) = 0;
+    virtual bool computeStep(Ray& ray, const World& world) = 0;
+    /**
+     * Traces a ray from its last trace point until it hits an AABB or leaves the scene.
+     * @note The traversal loop runs inside the algorithm, steps are not dispatched virtually.
+     * @param   ray     Ray to trace
+     * @param   scene   Voxel scene to use to check for intersections
+     * @return  The closest hit, or a Hit with found set to false
+     */
+    virtual Hit traceRay(Ray& ray, const SandboxScene& scene) = 0;
+    virtual Hit traceRay(Ray& ray, const World& world) = 0;
+    /**
+     * Builds what the algorithm reads besides the scene (octree, brickmap...), before any ray is traced in it.
+     * @note Kept as long as the revision of the scene does not change, it must be called again once the scene is edited.
+     * @param   scene   Voxel scene the next rays are traced in
+     */
+    virtual void prepare(const SandboxScene& scene) = 0;
+    virtual void prepare(const World& world) = 0;
+};
+
+/**
+ * Implements the virtual calls of RayAlgorithm with the kernelStep of the concrete algorithm (CRTP).
+ * @note Derived provides template<VoxelScene Scene> bool kernelStep(Ray& ray, const Scene& scene, Hit& hit), a step
+ *       of the algorithm also recording the voxel and box index of a hit. It is not virtual so that traceRayStatic
+ *       can inline it in its loop. Derived may also provide template<VoxelScene Scene> void build(const Scene& scene),
+ *       called by prepare. The kernels and these calls are instantiated for every algorithm in ray_algorithm.cpp.
+ */
+template<typename Derived>
+class StaticRayAlgorithm : public RayAlgorithm {
+public:
+    bool computeStep(Ray& ray, const SandboxScene& scene);
+    bool computeStep(Ray& ray, const World& world);
+    Hit traceRay(Ray& ray, const SandboxScene& scene);
+    Hit traceRay(Ray& ray, const World& world);
+    void prepare(const SandboxScene& scene);
+    void prepare(const World& world);
+    /**
+     * Nothing to build by default.
+     */
+    template<VoxelScene Scene>
+    void build(const Scene&) {}
 };
 
 
 /**
  * Classical implementation of the slab algorithm for a ray shooting AABB intersection problem.
  */
-class SlabAlgorithm : public RayAlgorithm {
+class SlabAlgorithm : public StaticRayAlgorithm<SlabAlgorithm> {
 public:
     /**
      * Classical implementation of the slab algorithm.
      * @param   ray     Ray to continue
      * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
      * @return  True if an intersection was found
      */
-    bool computeStep(Ray& ray, const SandboxScene& scene);
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
 };
 
 /**
  * Fixed marching implementation of the slab algorithm for a ray shooting AABB intersection problem.
  */
-class MarchingSlabAlgorithm : public RayAlgorithm {
+class MarchingSlabAlgorithm : public StaticRayAlgorithm<MarchingSlabAlgorithm> {
 private:
     /**
      * Step size to use when marching.
@@ -58,29 +172,33 @@ public:
      * Same Slab algorithm but does not go to next voxel, rather uses a march step.
      * @param   ray     Ray to continue
      * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
      * @return  True if an intersection was found
      */
-    bool computeStep(Ray& ray, const SandboxScene& scene);
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
 };
 
 /**
  * Classical implementation of the slab algorithm for a ray shooting AABB intersection problem.
  */
-class BitmaskAlgorithm : public RayAlgorithm {
+class BitmaskAlgorithm : public StaticRayAlgorithm<BitmaskAlgorithm> {
 public:
     /**
      * TODO explain the algorithm
      * @param   ray     Ray to continue
      * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
      * @return  True if an intersection was found
      */
-    bool computeStep(Ray& ray, const SandboxScene& scene);
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
 };
 
 /**
  * Fixed marching implementation of the bitmask algorithm for a ray shooting AABB intersection problem.
  */
-class MarchingBitmaskAlgorithm : public RayAlgorithm {
+class MarchingBitmaskAlgorithm : public StaticRayAlgorithm<MarchingBitmaskAlgorithm> {
 private:
     /**
      * Step size to use when marching.
@@ -96,10 +214,477 @@ public:
      * Same Bitmask algorithm but does not go to next voxel, rather uses a march step.
      * @param   ray     Ray to continue
      * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
      * @return  True if an intersection was found
      */
-    bool computeStep(Ray& ray, const SandboxScene& scene);
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
+};
+
+/**
+ * Marching implementation of the slab algorithm whose steps are given by a distance field of the scene instead of a
+ * fixed length (sphere tracing over the voxels).
+ * @note Each step leaves the cube of empty voxels around the current voxel given by its distance, occupied voxels
+ *       being tested with the slab test and left like a cube of a single voxel. The field is built by prepare before
+ *       the rays are traced, and shared by the copies of the algorithm.
+ */
+class DistanceMarchingAlgorithm : public StaticRayAlgorithm<DistanceMarchingAlgorithm> {
+private:
+    /**
+     * Distance field of the scene, nullptr until it is built.
+     */
+    std::shared_ptr<const DistanceField> field;
+    /**
+     * Revision of the scene the field was built from.
+     */
+    uint64_t field_revision;
+    /**
+     * Distance along the ray of its last trace point.
+     */
+    double t;
+
+public:
+    /**
+     * Constructor building no field, it is built by prepare.
+     */
+    DistanceMarchingAlgorithm() : field(), field_revision(0), t(0.) {}
+    /**
+     * Builds the distance field of a scene, unless the field was already built from its current revision.
+     * @param   scene   Scene the next rays are traced in.
+     */
+    template<VoxelScene Scene>
+    void build(const Scene& scene) {
+        if (field && field_revision == scene.revision())
+            return;
+        field = std::make_shared<const DistanceField>(scene);
+        field_revision = scene.revision();
+    }
+    /**
+     * Getter for the distance field of the scene.
+     * @note    The field must have been built.
+     */
+    inline const DistanceField& getField() const {
+        return *field;
+    }
+    /**
+     * Tests the boxes of the current voxel if it is occupied, then marches out of the empty cube around it.
+     * @note The field must have been built from the current revision of the scene.
+     * @param   ray     Ray to continue
+     * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
+     * @return  True if an intersection was found
+     */
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
 };
 
+/**
+ * State of an incremental 3D DDA traversal (Amanatides & Woo), shared by the algorithms stepping voxel by voxel.
+ */
+class DDATraversal {
+protected:
+    /**
+     * Voxel currently traversed by the ray.
+     */
+    std::array<int, 3> cell;
+    /**
+     * Direction of the integer step on each axis (-1, 0 or 1).
+     */
+    std::array<int, 3> cell_step;
+    /**
+     * Distance along the ray at which the next voxel boundary is crossed on each axis.
+     */
+    std::array<double, 3> t_max;
+    /**
+     * Distance along the ray between two voxel boundaries on each axis.
+     */
+    std::array<double, 3> t_delta;
+
+    /**
+     * Computes the traversal state of a ray, only done once per ray.
+     * @param   ray     Ray that starts being traversed.
+     */
+    void initialize(const Ray& ray);
+    /**
+     * Moves the current voxel to the next one along the axis whose boundary is the closest.
+     * @return  Distance along the ray to the boundary crossed.
+     */
+    inline double advanceCell() {
+        int axis = (t_max[0] < t_max[1]) ? 0 : 1;
+        if (t_max[2] < t_max[axis])
+            axis = 2;
+        const double t = t_max[axis];
+        cell[axis] += cell_step[axis];
+        t_max[axis] += t_delta[axis];
+        return t;
+    }
+    /**
+     * Moves the ray to the next voxel along the axis whose boundary is the closest.
+     * @param   ray     Ray being traversed.
+     */
+    void advance(Ray& ray);
+    /**
+     * Moves the traversal to the voxel the ray enters when it crosses a boundary, the state being computed again from
+     * the crossing point instead of being stepped there.
+     * @param   ray     Ray being traversed.
+     * @param   t       Distance along the ray of the boundary crossed.
+     * @param   axis    Axis of the boundary, the voxel entered on it is low when the ray goes up this axis, high otherwise.
+     * @param   low     Lowest voxel of the box entered, the voxel containing the crossing point is clamped into it.
+     * @param   high    Highest voxel of the box entered.
+     */
+    void enterAt(Ray& ray, const double t, const int axis, const std::array<int, 3>& low,
+                 const std::array<int, 3>& high);
+    /**
+     * Moves the ray out of an empty region of the scene in a single step, without looking at its voxels.
+     * @note The ray jumps to the face of the region it exits through and the traversal state is computed again from
+     *       there, whatever the size of the region.
+     * @param   ray     Ray being traversed, its current voxel must be in the region.
+     * @param   min     Lowest voxel of the region.
+     * @param   max     Highest voxel of the region.
+     */
+    void crossRegion(Ray& ray, const VoxelPosition& min, const VoxelPosition& max);
+    /**
+     * Step shared by the DDA algorithms: leaves the empty region around the current voxel, or tests the voxel and
+     * moves to the next one.
+     * @note Policy is the concrete algorithm, its hooks are called statically (DDATraversal must be its friend):
+     *       - void beginRay(const Ray& ray), called once the traversal state of a new ray is computed;
+     *       - bool crossEmpty(Ray& ray, const Scene& scene, const VoxelPosition& tile), moving the ray out of an empty
+     *         region containing the voxel, false if the voxel must be tested;
+     *       - bool testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin, const Point& direction,
+     *         double& distance, Hit& hit), testing the boxes of the voxel with the origin relative to it, setting the
+     *         distance to the closest box hit along with the voxel and box index of the hit.
+     *       beginRay and crossEmpty default to the ones below.
+     * @param   policy  Algorithm providing the hooks.
+     * @param   ray     Ray to continue
+     * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
+     * @return  True if an intersection was found
+     */
+    template<typename Policy, VoxelScene Scene>
+    bool step(Policy& policy, Ray& ray, const Scene& scene, Hit& hit);
+    /**
+     * Nothing to prepare by default.
+     */
+    inline void beginRay(const Ray&) {}
+    /**
+     * Crosses the empty section or chunk containing the voxel (see findEmptyRegion) in a single step.
+     */
+    template<VoxelScene Scene>
+    bool crossEmpty(Ray& ray, const Scene& scene, const VoxelPosition& tile);
+};
+
+/**
+ * Incremental 3D DDA traversal (Amanatides & Woo) with a slab test in occupied voxels only.
+ */
+class DDAAlgorithm : public StaticRayAlgorithm<DDAAlgorithm>, protected DDATraversal {
+private:
+    friend class DDATraversal;
+    /**
+     * Slab test of the boxes of the voxel if it is occupied.
+     */
+    template<VoxelScene Scene>
+    bool testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin, const Point& direction,
+                   double& distance, Hit& hit);
+
+public:
+    /**
+     * Tests the boxes of the current voxel if it is occupied, otherwise advances to the next voxel.
+     * @note The traversal state is reset when the ray has not been stepped yet.
+     * @param   ray     Ray to continue
+     * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
+     * @return  True if an intersection was found
+     */
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
+};
+
+/**
+ * DDA traversal testing all the AABBs of an occupied voxel at once with a SIMD slab kernel.
+ */
+class SimdSlabAlgorithm : public StaticRayAlgorithm<SimdSlabAlgorithm>, protected DDATraversal {
+private:
+    /**
+     * Component-wise inverse of the direction of the ray being traversed.
+     */
+    Point inv_direction;
+
+    friend class DDATraversal;
+    /**
+     * Computes the inverse of the direction of the ray.
+     */
+    void beginRay(const Ray& ray);
+    /**
+     * SIMD slab test of the boxes of the voxel if it is occupied.
+     */
+    template<VoxelScene Scene>
+    bool testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin, const Point& direction,
+                   double& distance, Hit& hit);
+
+public:
+    /**
+     * Same as DDAAlgorithm::kernelStep but the boxes are read from the SoA blocks of the shape table.
+     * @param   ray     Ray to continue
+     * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
+     * @return  True if an intersection was found
+     */
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
+};
+
+/**
+ * DDA traversal looking voxels up in a sparse voxel octree of the scene, empty octants being crossed in one step.
+ * @note The octree is built by prepare before the rays are traced, and shared by the copies of the algorithm.
+ *       Empty octants are left by jumping straight to the point where the ray exits them, the DDA state being
+ *       computed again from there.
+ */
+class SvoAlgorithm : public StaticRayAlgorithm<SvoAlgorithm>, protected DDATraversal {
+private:
+    /**
+     * Octree of the scene, nullptr until it is built.
+     */
+    std::shared_ptr<const SparseVoxelOctree> octree;
+    /**
+     * Revision of the scene the octree was built from.
+     */
+    uint64_t octree_revision;
+    /**
+     * Shape of the current voxel, read from its leaf by crossEmpty.
+     */
+    ShapeId leaf_shape;
+    /**
+     * Amount of empty octants crossed and of voxels read from a leaf since the last reset.
+     */
+    uint64_t octant_steps, voxel_steps;
+
+    friend class DDATraversal;
+    /**
+     * Crosses the empty octant containing the voxel, or reads the shape of the voxel from its leaf.
+     */
+    template<VoxelScene Scene>
+    bool crossEmpty(Ray& ray, const Scene& scene, const VoxelPosition& tile);
+    /**
+     * Slab test of the boxes of the shape of the leaf, the scene is not read.
+     */
+    template<VoxelScene Scene>
+    bool testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin, const Point& direction,
+                   double& distance, Hit& hit);
+
+public:
+    /**
+     * Constructor building no octree, it is built by prepare.
+     */
+    SvoAlgorithm() : octree(), octree_revision(0), leaf_shape(EMPTY_SHAPE), octant_steps(0), voxel_steps(0) {}
+    /**
+     * Builds the octree of a scene, unless the octree was already built from its current revision.
+     * @param   scene   Scene the next rays are traced in.
+     */
+    template<VoxelScene Scene>
+    void build(const Scene& scene) {
+        if (octree && octree_revision == scene.revision())
+            return;
+        octree = std::make_shared<const SparseVoxelOctree>(scene);
+        octree_revision = scene.revision();
+    }
+    /**
+     * Getter for the octree of the scene.
+     * @note    The octree must have been built.
+     */
+    inline const SparseVoxelOctree& getOctree() const {
+        return *octree;
+    }
+    /**
+     * Getters for the amount of empty octants crossed and of voxels read from a leaf since the last reset.
+     */
+    inline uint64_t octantSteps() const {
+        return octant_steps;
+    }
+    inline uint64_t voxelSteps() const {
+        return voxel_steps;
+    }
+    inline void resetStepCounts() {
+        octant_steps = 0;
+        voxel_steps = 0;
+    }
+    /**
+     * Tests the boxes of the current voxel if the octree holds it, otherwise leaves the empty octant containing it.
+     * @note The octree must have been built from the current revision of the scene.
+     * @param   ray     Ray to continue
+     * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
+     * @return  True if an intersection was found
+     */
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
+};
+
+/**
+ * Two-level DDA traversal: the ray walks a coarse grid of bricks until it enters one holding an occupied voxel, then
+ * steps voxel by voxel inside it.
+ * @note The brickmap is built by prepare before the rays are traced, and shared by the copies of the algorithm.
+ *       Empty bricks are walked by a DDA over bricks, the voxel DDA state being computed again from the point where
+ *       the ray enters an occupied brick.
+ */
+class BrickmapAlgorithm : public StaticRayAlgorithm<BrickmapAlgorithm>, protected DDATraversal {
+private:
+    /**
+     * Side of the bricks in voxels.
+     */
+    int brick_side;
+    /**
+     * Brickmap of the scene, nullptr until it is built.
+     */
+    std::shared_ptr<const Brickmap> brickmap;
+    /**
+     * Revision of the scene the brickmap was built from.
+     */
+    uint64_t brickmap_revision;
+    /**
+     * Amount of empty bricks crossed and of voxels stepped through since the last reset.
+     */
+    uint64_t brick_steps, voxel_steps;
+
+    friend class DDATraversal;
+    /**
+     * Crosses the empty bricks ahead of the voxel with a DDA over bricks if its brick is empty.
+     */
+    template<VoxelScene Scene>
+    bool crossEmpty(Ray& ray, const Scene& scene, const VoxelPosition& tile);
+    /**
+     * Slab test of the boxes of the voxel if it is occupied, counted as a voxel step.
+     */
+    template<VoxelScene Scene>
+    bool testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin, const Point& direction,
+                   double& distance, Hit& hit);
+
+public:
+    /**
+     * Constructor taking the side of the bricks as a parameter.
+     * @param   side    Side of the bricks in voxels, 4 or 8.
+     */
+    BrickmapAlgorithm(const int side)
+    : brick_side(side), brickmap(), brickmap_revision(0), brick_steps(0), voxel_steps(0) {}
+    /**
+     * Builds the brickmap of a scene, unless the brickmap was already built from its current revision.
+     * @param   scene   Scene the next rays are traced in.
+     */
+    template<VoxelScene Scene>
+    void build(const Scene& scene) {
+        if (brickmap && brickmap_revision == scene.revision())
+            return;
+        brickmap = std::make_shared<const Brickmap>(scene, brick_side);
+        brickmap_revision = scene.revision();
+    }
+    /**
+     * Getter for the brickmap of the scene.
+     * @note    The brickmap must have been built.
+     */
+    inline const Brickmap& getBrickmap() const {
+        return *brickmap;
+    }
+    /**
+     * Getters for the amount of empty bricks crossed and of voxels stepped through since the last reset.
+     */
+    inline uint64_t brickSteps() const {
+        return brick_steps;
+    }
+    inline uint64_t voxelSteps() const {
+        return voxel_steps;
+    }
+    inline void resetStepCounts() {
+        brick_steps = 0;
+        voxel_steps = 0;
+    }
+    /**
+     * Crosses the empty bricks ahead in a single step, or tests the boxes of the current voxel if its brick is occupied.
+     * @note The brickmap must have been built from the current revision of the scene.
+     * @param   ray     Ray to continue
+     * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
+     * @return  True if an intersection was found
+     */
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
+};
+
+/**
+ * DDA traversal stepping through the sub-voxel mask of the shape of an occupied voxel (see
+ * ShapeTable::getSubvoxelMask) before testing its boxes.
+ * @note The boxes are only tested when the ray crosses a set cell of the mask, most rays passing next to slabs,
+ *       stairs or fences are rejected without any slab test. Voxels whose mask is full are tested directly.
+ */
+class SubvoxelAlgorithm : public StaticRayAlgorithm<SubvoxelAlgorithm>, protected DDATraversal {
+private:
+    /**
+     * Amount of occupied voxels entered and of those rejected by their mask since the last reset.
+     */
+    uint64_t occupied_steps, rejected_steps;
+
+    /**
+     * Walks through the cells of the current voxel crossed by the ray, from the point where it entered the voxel.
+     * @param   origin      Origin of the ray relative to the voxel.
+     * @param   direction   Normalized direction of the ray.
+     * @param   mask        Sub-voxel mask of the shape of the voxel.
+     * @return  True if a set cell of the mask is crossed.
+     */
+    bool crossesMask(const Point& origin, const Point& direction, const uint64_t mask) const;
+
+    friend class DDATraversal;
+    /**
+     * Slab test of the boxes of the voxel if it is occupied and the ray crosses its mask.
+     */
+    template<VoxelScene Scene>
+    bool testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin, const Point& direction,
+                   double& distance, Hit& hit);
+
+public:
+    SubvoxelAlgorithm() : occupied_steps(0), rejected_steps(0) {}
+    /**
+     * Getters for the amount of occupied voxels entered and of those rejected by their mask since the last reset.
+     */
+    inline uint64_t occupiedSteps() const {
+        return occupied_steps;
+    }
+    inline uint64_t rejectedSteps() const {
+        return rejected_steps;
+    }
+    inline void resetStepCounts() {
+        occupied_steps = 0;
+        rejected_steps = 0;
+    }
+    /**
+     * Tests the boxes of the current voxel if the ray crosses its sub-voxel mask, otherwise advances to the next voxel.
+     * @param   ray     Ray to continue
+     * @param   scene   Voxel scene to use to check for intersections
+     * @param   hit     Set to the voxel and box index of the intersection
+     * @return  True if an intersection was found
+     */
+    template<VoxelScene Scene>
+    bool kernelStep(Ray& ray, const Scene& scene, Hit& hit);
+};
+
+/**
+ * Statically dispatched traversal loop, instantiated for every algorithm and scene type in ray_algorithm.cpp.
+ * @note Algorithm is the concrete class, so its kernelStep is called directly and inlined in the loop.
+ * @param   algorithm   Algorithm to use.
+ * @param   ray         Ray to trace from its last trace point.
+ * @param   scene       Voxel scene to use to check for intersections.
+ * @return  The closest hit, or a Hit with found set to false.
+ */
+template<typename Algorithm, VoxelScene Scene>
+Hit traceRayStatic(Algorithm& algorithm, Ray& ray, const Scene& scene);
+
+extern template class StaticRayAlgorithm<SlabAlgorithm>;
+extern template class StaticRayAlgorithm<MarchingSlabAlgorithm>;
+extern template class StaticRayAlgorithm<BitmaskAlgorithm>;
+extern template class StaticRayAlgorithm<MarchingBitmaskAlgorithm>;
+extern template class StaticRayAlgorithm<DistanceMarchingAlgorithm>;
+extern template class StaticRayAlgorithm<DDAAlgorithm>;
+extern template class StaticRayAlgorithm<SimdSlabAlgorithm>;
+extern template class StaticRayAlgorithm<SvoAlgorithm>;
+extern template class StaticRayAlgorithm<BrickmapAlgorithm>;
+extern template class StaticRayAlgorithm<SubvoxelAlgorithm>;
+
 #endif//__RAYCAST_RAY_ALGORITHM__
 
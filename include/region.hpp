@@ -0,0 +1,168 @@
+/**
+ * @file region.hpp
+ */
+#ifndef __RAYCAST_REGION__
+#define __RAYCAST_REGION__
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "block_shapes.hpp"
+#include "scene.hpp"
+#include "world.hpp"
+
+/**
+ * Extension of the Minecraft region files.
+ */
+#define REGION_FILE_EXTENSION ".mca"
+/**
+ * Amount of chunks along x and z in a region.
+ */
+#define REGION_SIDE_CHUNKS 32
+/**
+ * Amount of chunks in a region.
+ */
+#define REGION_CHUNK_COUNT (REGION_SIDE_CHUNKS*REGION_SIDE_CHUNKS)
+/**
+ * Chunks of a region file are stored in sectors of this size.
+ */
+#define REGION_SECTOR_SIZE 4096
+/**
+ * Size of the header of a region file: chunk locations then chunk timestamps.
+ */
+#define REGION_HEADER_SIZE (2*REGION_SECTOR_SIZE)
+
+/**
+ * Tells if a file is a Minecraft region file from its extension.
+ * @param   path    File location.
+ * @return  True if the file ends with REGION_FILE_EXTENSION.
+ */
+bool isRegionFile(const std::string& path);
+
+/**
+ * Read-only view over a Minecraft region file (Anvil format).
+ * @note The file is memory mapped, only the sectors of the chunks read are loaded.
+ */
+class RegionFile {
+private:
+    // Attributes
+    /**
+     * Mapped content of the file.
+     */
+    const uint8_t* data;
+    /**
+     * Size of the file in bytes.
+     */
+    size_t size;
+
+public:
+    // Constructors
+    /**
+     * Maps a region file, exits if it can not be read or has no complete header.
+     * @param   regionPath  File location of the region file.
+     */
+    RegionFile(const std::string& regionPath);
+    RegionFile(const RegionFile&) = delete;
+    RegionFile& operator=(const RegionFile&) = delete;
+    ~RegionFile();
+
+    // Methods
+    /**
+     * Checks if a chunk has been generated in the region.
+     * @param   index   Index of the chunk in the region, x + z*REGION_SIDE_CHUNKS.
+     */
+    bool hasChunk(const int index) const;
+    /**
+     * Decompresses the NBT payload of a chunk with zlib.
+     * @param   index   Index of the chunk in the region, x + z*REGION_SIDE_CHUNKS.
+     * @param   nbt     Buffer receiving the uncompressed NBT, resized to its size. Its capacity is kept between calls.
+     * @return  True if the chunk is present and could be decompressed.
+     */
+    bool readChunk(const int index, std::vector<uint8_t>& nbt) const;
+};
+
+/**
+ * Section of a chunk as stored in the NBT, before its block states are unpacked.
+ */
+struct PackedSection {
+    /**
+     * Y position of the section in sections.
+     */
+    int y;
+    /**
+     * Shape of every entry of the palette.
+     */
+    std::vector<ShapeId> palette;
+    /**
+     * Packed palette indices as big-endian longs, nullptr when the palette has a single entry.
+     */
+    const uint8_t* data;
+    /**
+     * Amount of longs in data.
+     */
+    size_t long_count;
+};
+
+/**
+ * Decoder of the chunks of region files (1.18+ format) into full chunk scenes.
+ * @note The decoder keeps its buffers between chunks so that decoding a region does not allocate for every chunk.
+ *       It is not thread safe, each thread loading chunks uses its own decoder.
+ */
+class ChunkDecoder {
+private:
+    // Attributes
+    /**
+     * Uncompressed NBT of the last chunk read.
+     */
+    std::vector<uint8_t> nbt_buffer;
+    /**
+     * Sections of the last chunk decoded, only the first section_count ones are valid.
+     * @note Entries past section_count are kept so that their palettes keep their capacity.
+     */
+    std::vector<PackedSection> sections;
+    /**
+     * Amount of sections of the last chunk decoded.
+     */
+    size_t section_count;
+    /**
+     * Keeps the block states of the sections packed until they are first read (see Section::materialize).
+     */
+    bool lazy_sections;
+
+public:
+    // Constructors
+    /**
+     * Chunk decoder constructor.
+     * @param   lazy_sections   Builds lazy sections instead of expanding their voxels while decoding.
+     */
+    ChunkDecoder(const bool lazy_sections=false);
+
+    // Methods
+    /**
+     * Decompresses a chunk of a region file and decodes it.
+     * @param   region          Region file holding the chunk.
+     * @param   index           Index of the chunk in the region, x + z*REGION_SIDE_CHUNKS.
+     * @param   block_shapes    AABB of every block state.
+     * @param   position        Set to the xPos and zPos of the chunk.
+     * @param   chunk           Set to the chunk scene, y = 0 being the bottom of the section yPos.
+     * @return  False if the chunk is absent, can not be decompressed, is malformed or holds an unknown block state.
+     */
+    bool readChunk(const RegionFile& region, const int index, const BlockShapes& block_shapes,
+                   ChunkPosition& position, SandboxScene& chunk);
+    /**
+     * Decodes the NBT of a chunk into a full chunk scene.
+     * @note The palette of each section is resolved with block_shapes, block states are unpacked straight into the sections
+     *       unless the decoder builds lazy sections.
+     * @param   nbt             Uncompressed NBT of the chunk.
+     * @param   block_shapes    AABB of every block state.
+     * @param   position        Set to the xPos and zPos of the chunk.
+     * @param   chunk           Set to the chunk scene, y = 0 being the bottom of the section yPos.
+     * @return  False if the NBT is malformed or holds a block state missing from block_shapes, which is reported.
+     */
+    bool decode(std::span<const uint8_t> nbt, const BlockShapes& block_shapes, ChunkPosition& position,
+                SandboxScene& chunk);
+};
+
+#endif//__RAYCAST_REGION__
@@ -5,17 +5,39 @@
 #define __RAYCAST_SCENE__
 
 #include <string>
+#include <memory>
+#include <concepts>
 
 #include "voxel.hpp"
-
-#define CHUNK_SIDE_SIZE 16
+#include "lattice.hpp"
+#include "shape_table.hpp"
+#include "section.hpp"
+#include "block_shapes.hpp"
 
 /**
- * 3D Scene storage class to use.
+ * Legacy nested 3D storage.
+ * @note Only kept to benchmark it against FlatLattice3D.
  */
 template<typename T>
 using Lattice3D = std::vector<std::vector<std::vector<T>>>;
 
+/**
+ * Gives a new scene revision, every call returns a different one.
+ * @note Thread safe, shared by SandboxScene and World so that two scenes never have the same revision.
+ * @return  Revision never returned before.
+ */
+uint64_t nextSceneRevision();
+
+/**
+ * Parses a chunk JSON file and checks that it can be loaded by SandboxScene, without throwing.
+ * @param   chunkPath       File location of the chunk JSON file.
+ * @param   block_shapes    AABB of every block state, every block of the palettes must be found in it.
+ * @param   chunkData       Set to the root of the document.
+ * @return  False if the file can not be read, is not JSON, lacks xPos, zPos or sections, or holds values of
+ *          unexpected types or unknown block states.
+ */
+bool readChunkFile(const std::string& chunkPath, const BlockShapes& block_shapes, Json::Value& chunkData);
+
 /**
  * Class containing the entire information of the loaded scene.
  */
@@ -23,9 +45,42 @@ class SandboxScene {
 private:
     // Attributes
     /**
-     * 3D voxel scene containing Voxel objects identified by their coordinates.
+     * Dimensions of the scene in voxels.
+     */
+    int width, height, depth;
+    /**
+     * Section table, the voxel (x, y, z) is stored in the section (x, y, z)/SECTION_SIDE_SIZE.
+     */
+    FlatLattice3D<Section> sections;
+    /**
+     * Immutable table holding the boxes of every shape used in the scene.
+     */
+    std::shared_ptr<const ShapeTable> shapes;
+    /**
+     * Revision of the voxels of the scene, changed whenever they may have been modified.
+     */
+    uint64_t scene_revision;
+
+    // Methods
+    /**
+     * Getter for the section containing a voxel.
+     * @note    No checks are done on the position.
      */
-    Lattice3D<Voxel> voxels;
+    inline const Section& sectionAt(const VoxelPosition& p) const {
+        return sections.at((unsigned)p.x / SECTION_SIDE_SIZE, (unsigned)p.y / SECTION_SIDE_SIZE,
+                           (unsigned)p.z / SECTION_SIDE_SIZE);
+    }
+    inline Section& sectionAt(const VoxelPosition& p) {
+        return sections.at((unsigned)p.x / SECTION_SIDE_SIZE, (unsigned)p.y / SECTION_SIDE_SIZE,
+                           (unsigned)p.z / SECTION_SIDE_SIZE);
+    }
+    /**
+     * Fills a section of the scene from a section of a chunk JSON file.
+     * @param   section         JSON object of the section (palette and data).
+     * @param   block_shapes    AABB of every block state.
+     * @param   section_y       Index of the section along the y axis of the scene.
+     */
+    void loadSection(const Json::Value& section, const BlockShapes& block_shapes, const int section_y);
 
 public:
     // Constructors
@@ -34,70 +89,206 @@ public:
      * @param   width   Width of the scene.
      * @param   height  Height of the scene.
      * @param   depth   Depth of the scene.
+     * @param   table   Shapes that can be set in the scene, only the empty shape by default.
      */
-    SandboxScene(const int width, const int height, const int depth) {
-        voxels = Lattice3D<Voxel>(width, std::vector<std::vector<Voxel>>(
-            height, std::vector<Voxel>(depth, Voxel()))
-        );
-    }
+    SandboxScene(const int width, const int height, const int depth,
+                 std::shared_ptr<const ShapeTable> table=std::make_shared<const ShapeTable>());
     /**
      * Sandbox scene constructor that takes a chunk JSON file as input and contructs a scene from it.
      * @param   chunkPath       File location of the chunk JSON file.
-     * @param   shapesPath      File location of all the blocks' AABB and properties.
+     * @param   block_shapes    AABB of every block state.
      * @param   chosen_section  Section number to load.
      */
-    SandboxScene(const std::string& chunkPath, const std::string& shapesPath,
+    SandboxScene(const std::string& chunkPath, const BlockShapes& block_shapes,
                  const int chosen_section);
+    /**
+     * Sandbox scene constructor loading every section of a chunk JSON file.
+     * @note The scene is CHUNK_SIDE_SIZE wide and deep, its y = 0 is the bottom of the lowest section of the chunk.
+     *       Sections missing from the file are left empty.
+     * @param   chunkPath       File location of the chunk JSON file.
+     * @param   block_shapes    AABB of every block state.
+     */
+    SandboxScene(const std::string& chunkPath, const BlockShapes& block_shapes);
+    /**
+     * Sandbox scene constructor loading every section of an already parsed chunk.
+     * @note The bottom of the scene is the section yPos of the chunk when present, the lowest section otherwise.
+     * @param   chunkData       Root of the chunk JSON document.
+     * @param   block_shapes    AABB of every block state.
+     */
+    SandboxScene(const Json::Value& chunkData, const BlockShapes& block_shapes);
+    /**
+     * Sandbox scene constructor loading a binary scene file written by save.
+     * @note The file is memory mapped and its sections are copied directly into the scene. Files whose dimensions are
+     *       0 or too large, whose parts do not fit in the file, whose shape identifiers are not in their shape table or
+     *       whose occupancy bits do not match their voxels are rejected.
+     * @param   scenePath   File location of the binary scene file.
+     */
+    SandboxScene(const std::string& scenePath);
 
     // Methods
+    /**
+     * Writes the scene to a binary scene file (see SceneFileHeader).
+     * @param   scenePath   File location to write to.
+     */
+    void save(const std::string& scenePath) const;
     /**
      * Getter for a voxel in the scene given a position.
      * @param   position    Position of the requested voxel.
-     * @return  Voxel object found at that given position.
+     * @return  Voxel view over the boxes found at that given position.
      */
     inline Voxel getVoxel(const VoxelPosition& position) const {
-        return voxels[position.y][position.z][position.x];
+        return Voxel(shapes->getShape(getShapeId(position)));
     }
     /**
-     * Getter for a voxel in the scene given a position.
-     * @note    This version returns a reference!
+     * Getter for the shape identifier of a voxel in the scene.
      * @param   position    Position of the requested voxel.
-     * @return  Reference to the Voxel object found at that given position.
+     * @return  Identifier in the shape table.
      */
-    inline Voxel& getVoxel(const VoxelPosition& position) {
-        return voxels[position.y][position.z][position.x];
+    inline ShapeId getShapeId(const VoxelPosition& position) const {
+        return sectionAt(position).getShapeId(position.x % SECTION_SIDE_SIZE, position.y % SECTION_SIDE_SIZE,
+                                              position.z % SECTION_SIDE_SIZE);
     }
     /**
      * Setter of a voxel at a given position in the scene.
      * @param   position    Position of the voxel to set.
-     * @param   voxel       Voxel to set.
+     * @param   shape       Identifier of the shape in the scene's shape table.
+     */
+    inline void setVoxel(const VoxelPosition& position, const ShapeId shape) {
+        scene_revision = nextSceneRevision();
+        sectionAt(position).setVoxel(position.x % SECTION_SIDE_SIZE, position.y % SECTION_SIDE_SIZE,
+                                     position.z % SECTION_SIDE_SIZE, shape);
+    }
+    /**
+     * Tests if a voxel contains any AABB using the occupancy mask only.
+     * @param   position    Position of the voxel to test.
+     * @return  True if the voxel is not empty, positions outside of the scene are empty.
+     */
+    inline bool isOccupied(const VoxelPosition& position) const {
+        return inBounds(position) && sectionAt(position).isOccupied(position.x % SECTION_SIDE_SIZE, position.y % SECTION_SIDE_SIZE,
+                                              position.z % SECTION_SIDE_SIZE);
+    }
+    /**
+     * Looks for a box of voxels around a position that is known to be empty.
+     * @note Used by traversals to cross it without looking at its voxels.
+     * @param   position    Position inside the scene.
+     * @param   min         Set to the lowest voxel of the region if one is found.
+     * @param   max         Set to the highest voxel of the region if one is found.
+     * @return  True if the position is in an empty section.
+     */
+    inline bool findEmptyRegion(const VoxelPosition& position, VoxelPosition& min, VoxelPosition& max) const {
+        if (!sectionAt(position).isEmpty())
+            return false;
+        min = VoxelPosition(position.x / SECTION_SIDE_SIZE * SECTION_SIDE_SIZE,
+                            position.y / SECTION_SIDE_SIZE * SECTION_SIDE_SIZE,
+                            position.z / SECTION_SIDE_SIZE * SECTION_SIDE_SIZE);
+        max = VoxelPosition(min.x + SECTION_SIDE_SIZE-1, min.y + SECTION_SIDE_SIZE-1, min.z + SECTION_SIDE_SIZE-1);
+        return true;
+    }
+    /**
+     * Checks if the scene has no box at all.
+     * @return  True if every section is uniformly empty.
+     */
+    bool isEmpty() const;
+    /**
+     * Getter for the shape table of the scene.
+     * @return  Const reference to the table.
+     */
+    inline const ShapeTable& getShapes() const {
+        return *shapes;
+    }
+    /**
+     * Getter for a section of the scene, used by loaders to fill it directly.
+     * @note    No checks are done on the coordinates, in sections. The revision of the scene is changed.
+     */
+    inline Section& getSection(const int x, const int y, const int z) {
+        scene_revision = nextSceneRevision();
+        return sections.at(x, y, z);
+    }
+    /**
+     * Getter for the revision of the voxels of the scene, used to tell if a structure built from them is up to date.
+     * @note A copy of the scene keeps its revision until one of them is modified.
+     */
+    inline uint64_t revision() const {
+        return scene_revision;
+    }
+    /**
+     * Getter for the section table.
+     * @return  Const reference to the sections, indexed by section coordinates.
      */
-    inline void setVoxel(const VoxelPosition& position, const Voxel& voxel) {
-        voxels[position.y][position.z][position.x] = voxel;
+    inline const FlatLattice3D<Section>& getSections() const {
+        return sections;
     }
+    /**
+     * Approximation of the memory used by the scene (sections and shape table).
+     * @return  Size in bytes.
+     */
+    size_t memoryUsage() const;
+    /**
+     * Makes the sections of the scene share their voxels with the identical sections already interned.
+     * @param   interner    Table of the distinct sections, shared by every scene deduplicated together.
+     */
+    void internSections(SectionInterner& interner);
+    /**
+     * Stores the voxels of every section of the scene in another order.
+     * @note Voxels shared between sections by internSections are copied, the layout should be set first.
+     * @param   layout  New order of the voxels of the sections.
+     */
+    void setVoxelLayout(const VoxelLayout layout);
     /**
      * Get the scene's side size.
      * @note We assume the scene is a cube in this context.
      * @return  Unsigned integer.
      */
     inline int side_size() const {
-        return (int)voxels.size();
+        return width;
     }
     /**
-     * TODO
+     * Getters for the dimensions of the scene.
+     */
+    inline int sizeX() const { return width; }
+    inline int sizeY() const { return height; }
+    inline int sizeZ() const { return depth; }
+    /**
+     * Dimensions of the scene as a point, the scene spans from the origin to this point.
+     */
+    inline Point extent() const {
+        return Point(width, height, depth);
+    }
+    /**
+     * Checks if a voxel position is inside the scene.
+     * @param   p   Position to check.
+     * @return  True if the position can be used with getVoxel.
      */
     inline bool inBounds(const VoxelPosition& p) const {
         return p.x >= 0 && p.y >= 0 && p.z >= 0
-            && p.x < (int)voxels.size() && p.y < (int)voxels.size() && p.z < (int)voxels.size();
+            && p.x < width && p.y < height && p.z < depth;
     }
     /**
-     * TODO
+     * Checks if a point is strictly inside the scene.
+     * @param   p   Point to check.
+     * @return  True if the point is inside the scene.
      */
     inline bool inBounds(const Point& p) const {
         return p.x() > 0. && p.y() > 0. && p.z() > 0.
-            && p.x() < voxels.size() && p.y() < voxels.size() && p.z() < voxels.size();
+            && p.x() < width && p.y() < height && p.z() < depth;
     }
 };
 
-#endif//__RAYCAST_SCENE__
+/**
+ * Voxel queries the ray algorithms are written against, SandboxScene and World both provide them.
+ */
+template<typename Scene>
+concept VoxelScene = requires(const Scene& scene, const VoxelPosition& position, const Point& point,
+                              VoxelPosition& region_bound) {
+    { scene.inBounds(position) } -> std::same_as<bool>;
+    { scene.inBounds(point) } -> std::same_as<bool>;
+    { scene.isOccupied(position) } -> std::same_as<bool>;
+    { scene.getShapeId(position) } -> std::same_as<ShapeId>;
+    { scene.getVoxel(position) } -> std::same_as<Voxel>;
+    { scene.findEmptyRegion(position, region_bound, region_bound) } -> std::same_as<bool>;
+    { scene.getShapes() } -> std::same_as<const ShapeTable&>;
+    { scene.extent() } -> std::same_as<Point>;
+    { scene.revision() } -> std::same_as<uint64_t>;
+};
 
+#endif//__RAYCAST_SCENE__
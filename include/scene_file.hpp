@@ -0,0 +1,81 @@
+/**
+ * @file scene_file.hpp
+ */
+#ifndef __RAYCAST_SCENE_FILE__
+#define __RAYCAST_SCENE_FILE__
+
+#include <cstdint>
+#include <string>
+
+/**
+ * Extension of the binary scene files, any other chunk file is parsed as JSON.
+ */
+#define SCENE_FILE_EXTENSION ".rcs"
+/**
+ * Bytes found at the start of every binary scene file.
+ */
+#define SCENE_FILE_MAGIC "RCSCENE"
+/**
+ * Version of the binary scene format, bumped whenever the layout changes.
+ */
+#define SCENE_FILE_VERSION 2
+
+/**
+ * Value of an entry of the section table for a section whose voxels are stored.
+ */
+#define SCENE_FILE_DENSE_SECTION 0xFFFFFFFFu
+
+/**
+ * Header of a binary scene file.
+ * @note The file is written in the native byte order, it is followed by these parts, each aligned on a cache line:
+ *       shape offsets (uint32_t[shape_count+1]), boxes (AABB[box_count]),
+ *       section table (uint32_t[section_count] in [y][z][x] order, the shape of a uniform section or SCENE_FILE_DENSE_SECTION)
+ *       and dense sections (ShapeId[SECTION_VOLUME] then uint64_t[SECTION_VOLUME/64] occupancy words each, in table order).
+ */
+struct SceneFileHeader {
+    /**
+     * SCENE_FILE_MAGIC followed by a null byte.
+     */
+    char magic[8];
+    /**
+     * SCENE_FILE_VERSION of the writer.
+     */
+    uint32_t version;
+    /**
+     * Dimensions of the scene.
+     */
+    uint32_t width, height, depth;
+    /**
+     * Amount of shapes in the shape table, including the empty one.
+     */
+    uint32_t shape_count;
+    /**
+     * Amount of boxes of all the shapes.
+     */
+    uint32_t box_count;
+    /**
+     * Amount of sections in the section table.
+     */
+    uint32_t section_count;
+    /**
+     * Amount of sections whose voxels are stored.
+     */
+    uint32_t dense_count;
+    /**
+     * Offsets in bytes from the start of the file of every part.
+     */
+    uint64_t offsets_offset, boxes_offset, sections_offset, dense_offset;
+    /**
+     * Total size of the file in bytes.
+     */
+    uint64_t file_size;
+};
+
+/**
+ * Tests if a chunk file is a binary scene file, based on its extension.
+ * @param   path    Path of the chunk file.
+ * @return  True if the file should be loaded with the binary scene constructor.
+ */
+bool isSceneFile(const std::string& path);
+
+#endif//__RAYCAST_SCENE_FILE__
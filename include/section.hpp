@@ -0,0 +1,395 @@
+/**
+ * @file section.hpp
+ */
+#ifndef __RAYCAST_SECTION__
+#define __RAYCAST_SECTION__
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "lattice.hpp"
+#include "shape_table.hpp"
+#include "occupancy.hpp"
+#include "morton.hpp"
+
+/**
+ * Side size of a section, a cube of voxels stored together.
+ */
+#define SECTION_SIDE_SIZE 16
+/**
+ * Amount of voxels in a section.
+ */
+#define SECTION_VOLUME (SECTION_SIDE_SIZE*SECTION_SIDE_SIZE*SECTION_SIDE_SIZE)
+
+/**
+ * Counters of the sections materialized since the program started (see Section::materialize).
+ */
+struct MaterializationStats {
+    /**
+     * Amount of packed sections expanded.
+     */
+    uint64_t sections;
+    /**
+     * Time spent expanding them, in nanoseconds.
+     */
+    uint64_t nanoseconds;
+};
+
+/**
+ * Voxels of a section kept as palette indices until the section is first read.
+ */
+struct PackedVoxels {
+    /**
+     * Shape of every entry of the palette, indices past it are empty voxels.
+     */
+    std::vector<ShapeId> palette;
+    /**
+     * Palette indices in [y][z][x] order, bits wide, the first one in the lowest bits and none spanning two words.
+     */
+    std::vector<uint64_t> words;
+    /**
+     * Width of an index in bits.
+     */
+    int bits;
+    /**
+     * Runs the expansion of the section once.
+     */
+    std::once_flag once;
+    /**
+     * Set once the section is expanded, read before every voxel access.
+     */
+    std::atomic<bool> ready;
+};
+
+/**
+ * Order of the voxels of a dense section in its storage.
+ */
+enum class VoxelLayout : uint8_t {
+    /**
+     * [y][z][x] order, like the Minecraft section data.
+     */
+    ROW_MAJOR,
+    /**
+     * Morton order (see mortonEncode), neighbours along any axis are closer on average.
+     */
+    MORTON
+};
+
+/**
+ * Voxels of a dense section, identical sections may share the same block (see SectionInterner).
+ */
+struct DenseVoxels {
+    /**
+     * Shape of every voxel.
+     */
+    FlatLattice3D<ShapeId> voxels;
+    /**
+     * One bit per voxel telling if it contains any AABB.
+     */
+    OccupancyMask occupancy;
+    /**
+     * Order of both the voxels and the occupancy bits.
+     */
+    VoxelLayout layout;
+};
+
+/**
+ * Counters of the sections interned by a SectionInterner.
+ */
+struct DedupStats {
+    /**
+     * Amount of dense sections interned.
+     */
+    size_t dense_sections;
+    /**
+     * Amount of distinct voxel blocks among them.
+     */
+    size_t distinct_sections;
+    /**
+     * Memory no longer used by the sections sharing a block, in bytes.
+     */
+    size_t saved_bytes;
+};
+
+class SectionInterner;
+
+/**
+ * Cube of SECTION_SIDE_SIZE^3 voxels, stored as a single shape while all its voxels are the same.
+ * @note Minecraft sections with a palette of size 1 never need their voxels to be expanded.
+ *       A section built lazily keeps its packed palette indices and is expanded by the first read of one of its
+ *       voxels, from any thread. uniform and the voxels are mutable for that purpose only.
+ *       The voxels of dense sections are shared between copies, they are copied before one of them is written to.
+ *       Voxels are stored in [y][z][x] order unless the section is switched to another layout with setLayout.
+ */
+class Section {
+    friend class SectionInterner;
+
+private:
+    // Attributes
+    /**
+     * Shape of every voxel of a uniform section, unused otherwise.
+     */
+    mutable ShapeId uniform;
+    /**
+     * Voxels of a dense section, nullptr for a uniform section.
+     */
+    mutable std::shared_ptr<DenseVoxels> dense;
+    /**
+     * Storage of the voxels and occupancy words of dense, kept here so that reads do not go through dense.
+     * @note nullptr for a uniform section.
+     */
+    mutable const ShapeId* voxel_data;
+    mutable const uint64_t* occupancy_data;
+    /**
+     * Packed voxels of a lazy section, nullptr otherwise.
+     * @note Never reset once the section is loaded so that readers only have to check ready.
+     */
+    std::unique_ptr<PackedVoxels> packed;
+    /**
+     * Order of the voxels of dense, and of the voxels expanded from packed.
+     */
+    VoxelLayout layout;
+
+    // Methods
+    /**
+     * Offset of a voxel in the voxels of a section stored in a given order.
+     */
+    static inline size_t index(const int x, const int y, const int z, const VoxelLayout layout) {
+        if (layout == VoxelLayout::MORTON)
+            return mortonEncode(x, y, z);
+        return ((size_t)y*SECTION_SIDE_SIZE + z)*SECTION_SIDE_SIZE + x;
+    }
+    /**
+     * Points voxel_data and occupancy_data to the storage of dense.
+     */
+    inline void refreshData() const {
+        voxel_data = dense ? dense->voxels.raw() : nullptr;
+        occupancy_data = dense ? dense->occupancy.raw() : nullptr;
+    }
+    /**
+     * Copies the voxels if they are shared with another section, before writing to them.
+     */
+    void unshare() const;
+    /**
+     * Fills the voxels from palette indices, the section stays uniform if they all map to the same shape.
+     * @param   palette Shape of every entry of the palette.
+     * @param   words   Palette indices, see PackedVoxels.
+     * @param   bits    Width of an index in bits.
+     */
+    void unpack(const std::vector<ShapeId>& palette, const uint64_t* words, const int bits) const;
+    /**
+     * Expands the packed voxels, only the first call does it, the others wait for it to be done.
+     */
+    void materializeSlow() const;
+    /**
+     * Writes a voxel of an expanded section.
+     */
+    inline void storeVoxel(const int x, const int y, const int z, const ShapeId shape) const {
+        if (!dense) {
+            if (shape == uniform)
+                return;
+            allocate();
+        }
+        const size_t i = index(x, y, z, layout);
+        dense->voxels.raw()[i] = shape;
+        dense->occupancy.set(i, shape != EMPTY_SHAPE);
+    }
+    /**
+     * Allocates the voxels of a uniform section, filled with its shape.
+     */
+    void allocate() const;
+
+public:
+    // Constructors
+    /**
+     * Builds a uniform section.
+     * @param   shape   Shape of every voxel.
+     */
+    Section(const ShapeId shape=EMPTY_SHAPE)
+    : uniform(shape), dense(), voxel_data(nullptr), occupancy_data(nullptr), packed(), layout(VoxelLayout::ROW_MAJOR) {}
+    /**
+     * Builds a section from packed palette indices.
+     * @param   palette Shape of every entry of the palette, indices past it are empty voxels.
+     * @param   words   Palette indices, see PackedVoxels. Must hold SECTION_VOLUME indices.
+     * @param   bits    Width of an index in bits.
+     * @param   lazy    Keeps the indices packed until a voxel is read instead of expanding them now.
+     */
+    Section(std::vector<ShapeId> palette, std::vector<uint64_t> words, const int bits, const bool lazy);
+    /**
+     * Copies a section, a copy of a lazy section that is not expanded yet is lazy too.
+     * @note The voxels of a dense section are shared with the copy.
+     *       The section copied must not be expanded at the same time.
+     */
+    Section(const Section& other);
+    Section& operator=(const Section& other);
+    Section(Section&& other) noexcept;
+    Section& operator=(Section&& other) noexcept;
+
+    // Methods
+    /**
+     * Expands the voxels of a lazy section if they are still packed.
+     * @note Thread safe, every voxel accessor calls it first.
+     */
+    inline void materialize() const {
+        if (packed && !packed->ready.load(std::memory_order_acquire))
+            materializeSlow();
+    }
+    /**
+     * Tests if the voxels of the section are still packed.
+     */
+    inline bool isPacked() const {
+        return packed && !packed->ready.load(std::memory_order_acquire);
+    }
+    /**
+     * Tests if all the voxels of the section share the same shape.
+     */
+    inline bool isUniform() const {
+        materialize();
+        return !voxel_data;
+    }
+    /**
+     * Tests if the section does not contain any AABB.
+     * @note Only uniform sections are detected, a dense section emptied with setVoxel is not.
+     *       Lazy sections are not expanded to answer, they are never empty.
+     */
+    inline bool isEmpty() const {
+        return !packed && !voxel_data && uniform == EMPTY_SHAPE;
+    }
+    /**
+     * Getter for the shape of a voxel.
+     * @note    No checks are done on the coordinates, local to the section.
+     */
+    inline ShapeId getShapeId(const int x, const int y, const int z) const {
+        return isUniform() ? uniform : voxel_data[index(x, y, z, layout)];
+    }
+    /**
+     * Tests if a voxel contains any AABB.
+     * @note    No checks are done on the coordinates, local to the section.
+     */
+    inline bool isOccupied(const int x, const int y, const int z) const {
+        if (isUniform())
+            return uniform != EMPTY_SHAPE;
+        const size_t i = index(x, y, z, layout);
+        return (occupancy_data[i >> 6] >> (i & 63)) & 1;
+    }
+    /**
+     * Setter of a voxel, a uniform section is expanded when one of its voxels changes.
+     * @note    No checks are done on the coordinates, local to the section.
+     */
+    inline void setVoxel(const int x, const int y, const int z, const ShapeId shape) {
+        materialize();
+        unshare();
+        storeVoxel(x, y, z, shape);
+    }
+    /**
+     * Allocates the voxels of a uniform section, filled with its shape.
+     */
+    void expand() {
+        materialize();
+        allocate();
+    }
+    /**
+     * Counters of the lazy sections expanded by every thread so far.
+     */
+    static MaterializationStats getMaterializationStats();
+    /**
+     * Getter for the shape of a uniform section.
+     */
+    inline ShapeId getUniformShape() const {
+        materialize();
+        return uniform;
+    }
+    /**
+     * Stores the voxels in another order, dense voxels shared with other sections are copied.
+     * @note The voxels of a lazy section are stored in that order once expanded.
+     * @param   target  New order of the voxels.
+     */
+    void setLayout(const VoxelLayout target);
+    /**
+     * Getter for the order of the voxels.
+     */
+    inline VoxelLayout getLayout() const {
+        return layout;
+    }
+    /**
+     * Raw access to the voxels of a dense section, in the order given by getLayout.
+     */
+    inline const ShapeId* rawVoxels() const {
+        materialize();
+        return voxel_data;
+    }
+    inline ShapeId* rawVoxels() {
+        materialize();
+        unshare();
+        return dense ? dense->voxels.raw() : nullptr;
+    }
+    /**
+     * Raw access to the occupancy words of a dense section, in the order given by getLayout.
+     */
+    inline const uint64_t* rawOccupancy() const {
+        materialize();
+        return occupancy_data;
+    }
+    inline uint64_t* rawOccupancy() {
+        materialize();
+        unshare();
+        return dense ? dense->occupancy.raw() : nullptr;
+    }
+    /**
+     * Memory used by the voxels of the section.
+     * @note Voxels shared by several sections are split evenly between them.
+     * @return  Size in bytes.
+     */
+    inline size_t memoryUsage() const {
+        size_t total = sizeof(Section);
+        if (dense)
+            total += (sizeof(DenseVoxels) + dense->voxels.size()*sizeof(ShapeId) + dense->occupancy.memoryUsage())
+                   / dense.use_count();
+        if (packed)
+            total += sizeof(PackedVoxels) + packed->palette.capacity()*sizeof(ShapeId)
+                   + packed->words.capacity()*sizeof(uint64_t);
+        return total;
+    }
+};
+
+/**
+ * Table of the distinct dense sections seen so far, used to make identical sections share their voxels.
+ * @note Sections are compared by hashing then comparing their voxels, the occupancy following from them. Only
+ *       sections with the same layout are compared.
+ *       Lazy sections that are still packed are left as they are.
+ */
+class SectionInterner {
+private:
+    // Attributes
+    /**
+     * Distinct voxel blocks, by hash of their voxels.
+     */
+    std::unordered_map<uint64_t, std::vector<std::shared_ptr<DenseVoxels>>> blocks;
+    /**
+     * Counters of the sections interned.
+     */
+    DedupStats stats;
+
+public:
+    // Constructors
+    SectionInterner();
+
+    // Methods
+    /**
+     * Makes a dense section share the voxels of the first identical section interned.
+     * @param   section Section to intern, uniform and packed sections are ignored.
+     */
+    void intern(Section& section);
+    /**
+     * Getter for the counters of the sections interned.
+     */
+    inline const DedupStats& getStats() const {
+        return stats;
+    }
+};
+
+#endif//__RAYCAST_SECTION__
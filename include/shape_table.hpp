@@ -0,0 +1,136 @@
+/**
+ * @file shape_table.hpp
+ */
+#ifndef __RAYCAST_SHAPE_TABLE__
+#define __RAYCAST_SHAPE_TABLE__
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "voxel.hpp"
+#include "lattice.hpp"
+
+/**
+ * Identifier of a shape (list of AABB) in a ShapeTable.
+ */
+using ShapeId = uint16_t;
+
+/**
+ * Shape identifier reserved for empty voxels (no AABB).
+ */
+#define EMPTY_SHAPE 0
+
+/**
+ * Amount of boxes stored together in a SoA block of the shape table.
+ * @note Matches the 4 doubles of an AVX2 register.
+ */
+#define SHAPE_BLOCK_WIDTH 4
+/**
+ * Amount of doubles in a SoA block: minX, minY, minZ, maxX, maxY, maxZ for SHAPE_BLOCK_WIDTH boxes.
+ */
+#define SHAPE_BLOCK_SIZE (6*SHAPE_BLOCK_WIDTH)
+/**
+ * Amount of sub-voxel cells along each axis of a voxel in the sub-voxel masks of the shapes.
+ * @note SUBVOXEL_SIDE^3 cells must fit in the 64 bits of a mask.
+ */
+#define SUBVOXEL_SIDE 4
+
+/**
+ * Deduplicated storage of every AABB list used by a scene.
+ * @note Voxels only store a ShapeId, the boxes themselves live once in this table.
+ */
+class ShapeTable {
+private:
+    // Attributes
+    /**
+     * Boxes of all the shapes stored contiguously.
+     */
+    std::vector<AABB> boxes;
+    /**
+     * Shape i is made of boxes [offsets[i], offsets[i+1]).
+     */
+    std::vector<uint32_t> offsets;
+    /**
+     * Same boxes stored as blocks of SHAPE_BLOCK_WIDTH boxes in SoA layout, padded with unused lanes.
+     */
+    std::vector<double, AlignedAllocator<double>> soa;
+    /**
+     * Shape i is made of the SoA blocks [block_offsets[i], block_offsets[i+1]).
+     */
+    std::vector<uint32_t> block_offsets;
+    /**
+     * Sub-voxel mask of every shape, see getSubvoxelMask.
+     */
+    std::vector<uint64_t> subvoxel_masks;
+    /**
+     * Map from the raw bytes of a box list to its identifier, used to deduplicate shapes.
+     */
+    std::unordered_map<std::string, ShapeId> lookup;
+
+public:
+    // Constructors
+    /**
+     * Builds a table only containing the empty shape (EMPTY_SHAPE).
+     */
+    ShapeTable();
+
+    // Methods
+    /**
+     * Adds a shape to the table if it is not already present.
+     * @param   shape   Boxes of the shape.
+     * @return  Identifier of the shape.
+     */
+    ShapeId intern(std::span<const AABB> shape);
+    /**
+     * Getter for the boxes of a shape.
+     * @note    No checks are done on the value of id.
+     * @param   id  Identifier of the shape.
+     * @return  Read-only view over the boxes.
+     */
+    inline std::span<const AABB> getShape(const ShapeId id) const {
+        return std::span<const AABB>(boxes.data()+offsets[id], offsets[id+1]-offsets[id]);
+    }
+    /**
+     * Getter for the SoA blocks of a shape.
+     * @note    Lanes past the box count of the shape are padding and must be ignored.
+     * @param   id  Identifier of the shape.
+     * @return  Pointer to the first block, aligned on a cache line.
+     */
+    inline const double* getShapeBlocks(const ShapeId id) const {
+        return soa.data() + (size_t)block_offsets[id]*SHAPE_BLOCK_SIZE;
+    }
+    /**
+     * Amount of boxes of a shape.
+     * @param   id  Identifier of the shape.
+     */
+    inline uint32_t getBoxCount(const ShapeId id) const {
+        return offsets[id+1]-offsets[id];
+    }
+    /**
+     * Getter for the cells of the voxel a shape may be hit in, the voxel being split in SUBVOXEL_SIDE^3 cells.
+     * @note Cell (x, y, z) is the bit (y*SUBVOXEL_SIDE+z)*SUBVOXEL_SIDE+x. Cells touching a box are set too, and
+     *       every cell is set when a box of the shape reaches out of the voxel. A ray crossing no set cell of a
+     *       voxel cannot hit any box of its shape.
+     * @param   id  Identifier of the shape.
+     * @return  One bit per cell, 0 for the empty shape.
+     */
+    inline uint64_t getSubvoxelMask(const ShapeId id) const {
+        return subvoxel_masks[id];
+    }
+    /**
+     * Amount of distinct shapes stored, including the empty one.
+     */
+    inline size_t size() const {
+        return offsets.size()-1;
+    }
+    /**
+     * Approximation of the heap memory used by the table.
+     * @return  Size in bytes.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif//__RAYCAST_SHAPE_TABLE__
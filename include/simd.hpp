@@ -0,0 +1,238 @@
+/**
+ * @file simd.hpp
+ */
+#ifndef __RAYCAST_SIMD__
+#define __RAYCAST_SIMD__
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#include "geometry.hpp"
+#include "shape_table.hpp"
+
+/**
+ * Name of the instruction set used by the SIMD kernels, for benchmark outputs.
+ */
+#if defined(__AVX2__)
+#define SIMD_INSTRUCTION_SET "avx2"
+#elif defined(__SSE2__)
+#define SIMD_INSTRUCTION_SET "sse2"
+#else
+#define SIMD_INSTRUCTION_SET "scalar"
+#endif
+
+/**
+ * Slab test between a ray and every box of a shape stored as SoA blocks (see ShapeTable::getShapeBlocks).
+ * @note Same results as calling slabsRayHitsBox on every box and keeping the closest one.
+ * @param   origin          Origin of the ray relative to the voxel.
+ * @param   direction       Normalized direction of the ray.
+ * @param   inv_direction   Component-wise inverse of the direction.
+ * @param   blocks          SoA blocks of the shape.
+ * @param   count           Amount of boxes in the shape.
+ * @param   distance        Set to the distance to the closest box along the ray if one is hit.
+ * @return  Index of the closest box hit, -1 if none is hit.
+ */
+inline int simdSlabsNearestBox(const Point& origin, const Point& direction, const Point& inv_direction,
+                               const double* blocks, const uint32_t count, double& distance) {
+    int nearest = -1;
+    double min_distance = HUGE_VAL;
+
+    for (uint32_t first=0; first<count; first+=SHAPE_BLOCK_WIDTH, blocks+=SHAPE_BLOCK_SIZE) {
+        alignas(32) double t_near_lanes[SHAPE_BLOCK_WIDTH];
+        int hit_mask;
+#if defined(__AVX2__)
+        // Lanes past the end of the shape are padding
+        __m256d valid = _mm256_cmp_pd(_mm256_set_pd(3., 2., 1., 0.),
+                                      _mm256_set1_pd((double)(count-first)), _CMP_LT_OQ);
+        __m256d t_near = _mm256_set1_pd(-HUGE_VAL);
+        __m256d t_far = _mm256_set1_pd(HUGE_VAL);
+        for (int axis=0; axis<3; ++axis) {
+            const __m256d box_min = _mm256_load_pd(blocks + axis*SHAPE_BLOCK_WIDTH);
+            const __m256d box_max = _mm256_load_pd(blocks + (axis+3)*SHAPE_BLOCK_WIDTH);
+            const __m256d o = _mm256_set1_pd(origin[axis]);
+            if (direction[axis] == 0) {
+                // Parallel to the planes, the origin has to lie between them
+                valid = _mm256_and_pd(valid, _mm256_and_pd(
+                    _mm256_cmp_pd(o, box_min, _CMP_GE_OQ), _mm256_cmp_pd(o, box_max, _CMP_LE_OQ)));
+                continue;
+            }
+            const __m256d inv = _mm256_set1_pd(inv_direction[axis]);
+            const __m256d t1 = _mm256_mul_pd(_mm256_sub_pd(box_min, o), inv);
+            const __m256d t2 = _mm256_mul_pd(_mm256_sub_pd(box_max, o), inv);
+            t_near = _mm256_max_pd(t_near, _mm256_min_pd(t1, t2));
+            t_far = _mm256_min_pd(t_far, _mm256_max_pd(t1, t2));
+        }
+        // Hit if the box is not missed nor behind the ray
+        const __m256d hit = _mm256_and_pd(valid, _mm256_and_pd(
+            _mm256_cmp_pd(t_near, t_far, _CMP_LE_OQ),
+            _mm256_cmp_pd(t_far, _mm256_setzero_pd(), _CMP_GE_OQ)));
+        hit_mask = _mm256_movemask_pd(hit);
+        _mm256_store_pd(t_near_lanes, t_near);
+#elif defined(__SSE2__)
+        hit_mask = 0;
+        for (int half=0; half<SHAPE_BLOCK_WIDTH; half+=2) {
+            __m128d valid = _mm_cmplt_pd(_mm_set_pd(half+1., half+0.), _mm_set1_pd((double)(count-first)));
+            __m128d t_near = _mm_set1_pd(-HUGE_VAL);
+            __m128d t_far = _mm_set1_pd(HUGE_VAL);
+            for (int axis=0; axis<3; ++axis) {
+                const __m128d box_min = _mm_load_pd(blocks + axis*SHAPE_BLOCK_WIDTH + half);
+                const __m128d box_max = _mm_load_pd(blocks + (axis+3)*SHAPE_BLOCK_WIDTH + half);
+                const __m128d o = _mm_set1_pd(origin[axis]);
+                if (direction[axis] == 0) {
+                    valid = _mm_and_pd(valid, _mm_and_pd(_mm_cmpge_pd(o, box_min), _mm_cmple_pd(o, box_max)));
+                    continue;
+                }
+                const __m128d inv = _mm_set1_pd(inv_direction[axis]);
+                const __m128d t1 = _mm_mul_pd(_mm_sub_pd(box_min, o), inv);
+                const __m128d t2 = _mm_mul_pd(_mm_sub_pd(box_max, o), inv);
+                t_near = _mm_max_pd(t_near, _mm_min_pd(t1, t2));
+                t_far = _mm_min_pd(t_far, _mm_max_pd(t1, t2));
+            }
+            const __m128d hit = _mm_and_pd(valid, _mm_and_pd(
+                _mm_cmple_pd(t_near, t_far), _mm_cmpge_pd(t_far, _mm_setzero_pd())));
+            hit_mask |= _mm_movemask_pd(hit) << half;
+            _mm_store_pd(t_near_lanes + half, t_near);
+        }
+#else
+        hit_mask = 0;
+        for (int lane=0; lane<SHAPE_BLOCK_WIDTH && first+lane<count; ++lane) {
+            double t_near = -HUGE_VAL;
+            double t_far = HUGE_VAL;
+            bool valid = true;
+            for (int axis=0; axis<3 && valid; ++axis) {
+                const double box_min = blocks[axis*SHAPE_BLOCK_WIDTH + lane];
+                const double box_max = blocks[(axis+3)*SHAPE_BLOCK_WIDTH + lane];
+                if (direction[axis] == 0) {
+                    valid = origin[axis] >= box_min && origin[axis] <= box_max;
+                    continue;
+                }
+                const double t1 = (box_min - origin[axis]) * inv_direction[axis];
+                const double t2 = (box_max - origin[axis]) * inv_direction[axis];
+                t_near = std::max(t_near, std::min(t1, t2));
+                t_far = std::min(t_far, std::max(t1, t2));
+            }
+            if (valid && t_near <= t_far && t_far >= 0)
+                hit_mask |= 1 << lane;
+            t_near_lanes[lane] = t_near;
+        }
+#endif
+        // Keep the closest hit box, in order so that ties go to the first box
+        for (int lane=0; lane<SHAPE_BLOCK_WIDTH; ++lane) {
+            if ((hit_mask >> lane) & 1 && t_near_lanes[lane] < min_distance) {
+                min_distance = t_near_lanes[lane];
+                nearest = (int)first + lane;
+            }
+        }
+    }
+
+    if (nearest >= 0)
+        distance = min_distance;
+    return nearest;
+}
+
+/**
+ * Slab test between a single box and 4 rays stored in lanes (used by packet tracing).
+ * @note Same results as calling slabsRayHitsBox for every lane.
+ * @param   origin          Origins of the rays relative to the voxel, axis i of lane j at origin[i*stride+j].
+ * @param   direction       Normalized directions of the rays, same layout.
+ * @param   inv_direction   Component-wise inverses of the directions, same layout.
+ * @param   stride          Distance between two axes in the arrays, aligned on 4 doubles.
+ * @param   box             Bounding box to test.
+ * @param   lanes           Mask of the lanes to test.
+ * @param   distance        Set to the distance to the box along each ray, only meaningful for lanes hitting it.
+ * @return  Mask of the lanes hitting the box.
+ */
+inline int simdSlabsPacket(const double* origin, const double* direction, const double* inv_direction,
+                           const size_t stride, const AABB& box, const int lanes, double* distance) {
+#if defined(__AVX2__)
+    __m256d valid = _mm256_castsi256_pd(_mm256_cmpgt_epi64(
+        _mm256_and_si256(_mm256_set1_epi64x(lanes), _mm256_set_epi64x(8, 4, 2, 1)), _mm256_setzero_si256()));
+    __m256d t_near = _mm256_set1_pd(-HUGE_VAL);
+    __m256d t_far = _mm256_set1_pd(HUGE_VAL);
+    for (int axis=0; axis<3; ++axis) {
+        const __m256d o = _mm256_load_pd(origin + axis*stride);
+        const __m256d box_min = _mm256_set1_pd(box.min[axis]);
+        const __m256d box_max = _mm256_set1_pd(box.max[axis]);
+        // Lanes parallel to the planes have to lie between them
+        const __m256d parallel = _mm256_cmp_pd(_mm256_load_pd(direction + axis*stride), _mm256_setzero_pd(), _CMP_EQ_OQ);
+        const __m256d inside = _mm256_and_pd(_mm256_cmp_pd(o, box_min, _CMP_GE_OQ), _mm256_cmp_pd(o, box_max, _CMP_LE_OQ));
+        valid = _mm256_andnot_pd(_mm256_andnot_pd(inside, parallel), valid);
+
+        const __m256d inv = _mm256_load_pd(inv_direction + axis*stride);
+        const __m256d t1 = _mm256_mul_pd(_mm256_sub_pd(box_min, o), inv);
+        const __m256d t2 = _mm256_mul_pd(_mm256_sub_pd(box_max, o), inv);
+        const __m256d t_min = _mm256_blendv_pd(_mm256_min_pd(t1, t2), _mm256_set1_pd(-HUGE_VAL), parallel);
+        const __m256d t_max = _mm256_blendv_pd(_mm256_max_pd(t1, t2), _mm256_set1_pd(HUGE_VAL), parallel);
+        t_near = _mm256_max_pd(t_near, t_min);
+        t_far = _mm256_min_pd(t_far, t_max);
+    }
+    const __m256d hit = _mm256_and_pd(valid, _mm256_and_pd(
+        _mm256_cmp_pd(t_near, t_far, _CMP_LE_OQ),
+        _mm256_cmp_pd(t_far, _mm256_setzero_pd(), _CMP_GE_OQ)));
+    _mm256_store_pd(distance, t_near);
+    return _mm256_movemask_pd(hit);
+#elif defined(__SSE2__)
+    int hit_mask = 0;
+    for (int half=0; half<4; half+=2) {
+        __m128d valid = _mm_castsi128_pd(_mm_set_epi64x(-(int64_t)((lanes >> (half+1)) & 1),
+                                                        -(int64_t)((lanes >> half) & 1)));
+        __m128d t_near = _mm_set1_pd(-HUGE_VAL);
+        __m128d t_far = _mm_set1_pd(HUGE_VAL);
+        for (int axis=0; axis<3; ++axis) {
+            const __m128d o = _mm_load_pd(origin + axis*stride + half);
+            const __m128d box_min = _mm_set1_pd(box.min[axis]);
+            const __m128d box_max = _mm_set1_pd(box.max[axis]);
+            const __m128d parallel = _mm_cmpeq_pd(_mm_load_pd(direction + axis*stride + half), _mm_setzero_pd());
+            const __m128d inside = _mm_and_pd(_mm_cmpge_pd(o, box_min), _mm_cmple_pd(o, box_max));
+            valid = _mm_andnot_pd(_mm_andnot_pd(inside, parallel), valid);
+
+            // No blend in SSE2, the bounds of the parallel lanes are selected with masks
+            const __m128d inv = _mm_load_pd(inv_direction + axis*stride + half);
+            const __m128d t1 = _mm_mul_pd(_mm_sub_pd(box_min, o), inv);
+            const __m128d t2 = _mm_mul_pd(_mm_sub_pd(box_max, o), inv);
+            const __m128d t_min = _mm_or_pd(_mm_andnot_pd(parallel, _mm_min_pd(t1, t2)),
+                                            _mm_and_pd(parallel, _mm_set1_pd(-HUGE_VAL)));
+            const __m128d t_max = _mm_or_pd(_mm_andnot_pd(parallel, _mm_max_pd(t1, t2)),
+                                            _mm_and_pd(parallel, _mm_set1_pd(HUGE_VAL)));
+            t_near = _mm_max_pd(t_near, t_min);
+            t_far = _mm_min_pd(t_far, t_max);
+        }
+        const __m128d hit = _mm_and_pd(valid, _mm_and_pd(
+            _mm_cmple_pd(t_near, t_far), _mm_cmpge_pd(t_far, _mm_setzero_pd())));
+        _mm_store_pd(distance + half, t_near);
+        hit_mask |= _mm_movemask_pd(hit) << half;
+    }
+    return hit_mask;
+#else
+    int hit_mask = 0;
+    for (int lane=0; lane<4; ++lane) {
+        if (!((lanes >> lane) & 1))
+            continue;
+        double t_near = -HUGE_VAL;
+        double t_far = HUGE_VAL;
+        bool valid = true;
+        for (int axis=0; axis<3 && valid; ++axis) {
+            const double o = origin[axis*stride + lane];
+            if (direction[axis*stride + lane] == 0) {
+                valid = o >= box.min[axis] && o <= box.max[axis];
+                continue;
+            }
+            const double t1 = (box.min[axis] - o) * inv_direction[axis*stride + lane];
+            const double t2 = (box.max[axis] - o) * inv_direction[axis*stride + lane];
+            t_near = std::max(t_near, std::min(t1, t2));
+            t_far = std::min(t_far, std::max(t1, t2));
+        }
+        if (valid && t_near <= t_far && t_far >= 0)
+            hit_mask |= 1 << lane;
+        distance[lane] = t_near;
+    }
+    return hit_mask;
+#endif
+}
+
+#endif//__RAYCAST_SIMD__
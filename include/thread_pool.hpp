@@ -0,0 +1,107 @@
+/**
+ * @file thread_pool.hpp
+ */
+#ifndef __RAYCAST_THREAD_POOL__
+#define __RAYCAST_THREAD_POOL__
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Fixed set of worker threads running submitted tasks.
+ * @note Tasks receive the index of the worker running them, in [0, size()), to pick per-thread scratch buffers.
+ */
+class ThreadPool {
+private:
+    // Attributes
+    /**
+     * Worker threads, started by the constructor and joined by the destructor.
+     */
+    std::vector<std::thread> workers;
+    /**
+     * Tasks waiting for a worker.
+     */
+    std::deque<std::function<void(int)>> tasks;
+    /**
+     * Amount of tasks queued or running.
+     */
+    size_t pending;
+    /**
+     * Set by the destructor to stop the workers.
+     */
+    bool stopping;
+    /**
+     * Protects tasks, pending and stopping.
+     */
+    std::mutex mutex;
+    /**
+     * Signaled when a task is queued or the pool stops.
+     */
+    std::condition_variable task_queued;
+    /**
+     * Signaled when pending drops to 0.
+     */
+    std::condition_variable tasks_done;
+
+    // Methods
+    /**
+     * Runs tasks until the pool stops.
+     * @param   worker  Index of the worker.
+     */
+    void workerLoop(const int worker);
+
+public:
+    // Constructors
+    /**
+     * Starts the workers.
+     * @param   thread_count    Amount of workers, at least one is started.
+     */
+    ThreadPool(const int thread_count);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    /**
+     * Waits for the queued tasks then stops the workers.
+     */
+    ~ThreadPool();
+
+    // Methods
+    /**
+     * Amount of workers.
+     */
+    inline int size() const {
+        return (int)workers.size();
+    }
+    /**
+     * Queues a task.
+     * @param   task    Callable taking the index of the worker running it.
+     */
+    void submit(std::function<void(int)> task);
+    /**
+     * Blocks until every queued task has run.
+     */
+    void wait();
+    /**
+     * Runs f(i, worker) for every i in [0, count) on the workers and waits for all of them.
+     * @note Indices are handed out one at a time, so uneven jobs are balanced between the workers.
+     * @param   count   Amount of jobs.
+     * @param   f       Callable taking the job index and the index of the worker running it.
+     */
+    template<typename F>
+    void parallelFor(const size_t count, F&& f) {
+        std::atomic<size_t> next(0);
+        for (int w=0; w<size(); ++w) {
+            submit([&next, &f, count](const int worker) {
+                for (size_t i=next++; i<count; i=next++)
+                    f(i, worker);
+            });
+        }
+        wait();
+    }
+};
+
+#endif//__RAYCAST_THREAD_POOL__
@@ -5,6 +5,8 @@
 #define __RAYCAST_UTIL__
 
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include "voxel.hpp"
 #include "scene.hpp"
@@ -12,11 +14,21 @@
 
 /**
  * Converts a string containing a list of AABB into a std::vector or AABB.
+ * @note Legacy parser allocating a string per coordinate, only kept to benchmark str_to_aabbs against it.
  * @param   s   String to convert.
  * @return  std::vector<AABB>
  */
 std::vector<AABB> str_to_aabbvector(const std::string& s);
 
+/**
+ * Parses a string containing a list of AABB (`[AABB[0, 0, 0] -> [1, 1, 1], ...]`) without any temporary string.
+ * @note The buffer is cleared first, reusing it between calls avoids any allocation once it is large enough.
+ * @param   s       String to parse.
+ * @param   output  Buffer receiving the boxes.
+ * @return  False if the string is malformed, output then holds the boxes parsed before the error.
+ */
+bool str_to_aabbs(std::string_view s, std::vector<AABB>& output);
+
 /**
  * Constructs rectangular cuboids (with vertices and faces vectors) and adds them to the polyscope scene.
  * @param   scene   Sandbox scene object containing all the voxels' AABBs.
@@ -7,9 +7,15 @@
 #include <iostream>
 #include <vector>
 #include <array>
+#include <span>
 
 #include "geometry.hpp"
 
+/**
+ * Side size of a chunk, also the size of a scene made of a single section.
+ */
+#define CHUNK_SIDE_SIZE 16
+
 /**
  * Structure to easily handle 3D coordinates of voxels.
  */
@@ -128,7 +134,8 @@ public:
 std::ostream& operator<<(std::ostream& os, const AABB& box);
 
 /**
- * Voxel class storing geometry elements using AABB.
+ * Voxel class giving access to the geometry elements (AABB) of a cell.
+ * @note The boxes are not owned, they live in the ShapeTable of the scene.
  */
 class Voxel {
 private:
@@ -136,54 +143,40 @@ private:
     /**
      * Bounding boxes of the voxel.
      */
-    std::vector<AABB> contents;
+    std::span<const AABB> contents;
 
 public:
     // Constructors
     /**
      * Default constructor building an empty Voxel.
      */
-    Voxel() : contents(std::vector<AABB>()) {}
-    /**
-     * Simple constructor for Voxels only having one AABB.
-     * @param   box     Bounding box to push in the Voxel's vector.
-     */
-    Voxel(const AABB& box) : contents(std::vector<AABB>(1, box)) {}
+    Voxel() : contents() {}
     /**
-     * Constructor taking a vector of AABBs and copying them into a new Voxel.
-     * @param   contents    Contents to copy to this voxel's contents.
+     * Constructor taking a view over AABBs stored elsewhere.
+     * @param   contents    Boxes of this voxel.
      */
-    Voxel(const std::vector<AABB>& contents) : contents(contents) {}
+    Voxel(std::span<const AABB> contents) : contents(contents) {}
 
     // Methods
     /**
-     * Returns a reference to the contents of the Voxel.
-     * @return  Reference to a std::vector.
+     * Returns the contents of the Voxel.
+     * @return  Read-only view over the boxes.
      */
-    inline std::vector<AABB>& getContents() {
+    inline std::span<const AABB> getContents() const {
         return contents;
     }
     /**
-     * Returns an iterator to the begining of the contents vector.
-     * @return  std::vector::begin().
+     * Returns an iterator to the begining of the contents.
      */
-    inline std::vector<AABB>::iterator begin() {
+    inline std::span<const AABB>::iterator begin() const {
         return contents.begin();
     }
     /**
-     * Returns an iterator to the end of the contents vector.
-     * @return  std::vector::end().
+     * Returns an iterator to the end of the contents.
      */
-    inline std::vector<AABB>::iterator end() {
+    inline std::span<const AABB>::iterator end() const {
         return contents.end();
     }
-    /**
-     * Adds a new bounding box to the contents of the voxel.
-     * @param   box     Bounding Box to add to the contents.
-     */
-    inline void addAABB(const AABB& box) {
-        contents.emplace_back(box);
-    }
     /**
      * Tests if the contents of the voxel are empty (no AABB).
      * @return true or false.
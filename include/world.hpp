@@ -0,0 +1,306 @@
+/**
+ * @file world.hpp
+ */
+#ifndef __RAYCAST_WORLD__
+#define __RAYCAST_WORLD__
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "voxel.hpp"
+#include "shape_table.hpp"
+#include "block_shapes.hpp"
+#include "scene.hpp"
+#include "thread_pool.hpp"
+
+/**
+ * The chunks of a world are indexed by a table over its bounding rectangle when they fill at least one slot out of this
+ * amount, they are looked up by position otherwise.
+ */
+#define WORLD_DENSE_INDEX_RATIO 16
+
+/**
+ * Position of a chunk in the world, in chunks (xPos and zPos of the chunk files).
+ */
+struct ChunkPosition {
+    int x, z;
+
+    bool operator==(const ChunkPosition&) const = default;
+};
+
+class ChunkCache;
+struct ChunkCacheStats;
+
+/**
+ * Hash of a chunk position, both coordinates are packed in a single 64 bits integer.
+ */
+struct ChunkPositionHash {
+    inline size_t operator()(const ChunkPosition& p) const {
+        return std::hash<uint64_t>()(((uint64_t)(uint32_t)p.x << 32) | (uint32_t)p.z);
+    }
+};
+
+/**
+ * Scene made of several chunks side by side, each one stored as a full chunk SandboxScene.
+ * @note The voxel (0, 0, 0) of the world is the lowest corner of the chunk with the smallest xPos and zPos.
+ *       Chunks missing from the world and chunks without any box are not stored and read as empty voxels.
+ */
+class World {
+private:
+    // Attributes
+    /**
+     * Chunks holding at least one box, keyed by their position.
+     */
+    std::unordered_map<ChunkPosition, SandboxScene, ChunkPositionHash> chunks;
+    /**
+     * Position of the chunk whose lowest corner is the voxel (0, 0, 0).
+     */
+    ChunkPosition origin;
+    /**
+     * Dimensions of the world in chunks along x and z.
+     */
+    int chunks_x, chunks_z;
+    /**
+     * Height of the world in voxels, shared by every chunk.
+     */
+    int height;
+    /**
+     * Chunks of the bounding rectangle of the world, chunk (x, z) relative to origin at z*chunks_x+x.
+     * @note Filled from chunks so that voxel queries do not hash, nullptr where no chunk is stored.
+     *       Left empty when the chunks are too sparse (see WORLD_DENSE_INDEX_RATIO), they are then found with findChunk.
+     */
+    std::vector<const SandboxScene*> index;
+    /**
+     * Immutable table holding the boxes of every shape used in the world, shared with every chunk.
+     */
+    std::shared_ptr<const ShapeTable> shapes;
+    /**
+     * Amount of chunks read that did not contain any box.
+     */
+    size_t empty_chunks;
+    /**
+     * Chunks of a streaming world, nullptr when every chunk is kept in chunks.
+     */
+    std::unique_ptr<ChunkCache> cache;
+    /**
+     * Slot and chunk of the last query of a streaming world, the cache is only asked when a query changes chunk.
+     */
+    mutable size_t cached_slot;
+    mutable const SandboxScene* cached_chunk;
+    /**
+     * Counters of the deduplication of the sections, all 0 if it was not requested.
+     */
+    DedupStats dedup_stats;
+    /**
+     * Revision of the voxels of the world, they are never modified once loaded.
+     */
+    uint64_t world_revision;
+
+    // Methods
+    /**
+     * Getter for the chunk containing a voxel.
+     * @note    The position must be in bounds.
+     * @return  Pointer to the chunk, nullptr if it is absent or empty.
+     */
+    inline const SandboxScene* chunkAt(const VoxelPosition& p) const {
+        const size_t slot = (size_t)(p.z / CHUNK_SIDE_SIZE)*chunks_x + p.x / CHUNK_SIDE_SIZE;
+        if (!index.empty())
+            return index[slot];
+        if (!cache)
+            return findChunk(slot);
+        if (slot != cached_slot) {
+            cached_chunk = fetchChunk(slot);
+            cached_slot = slot;
+        }
+        return cached_chunk;
+    }
+    /**
+     * Asks the cache of a streaming world for a chunk.
+     */
+    const SandboxScene* fetchChunk(const size_t slot) const;
+    /**
+     * Looks a chunk up by position in a world too sparse to be indexed.
+     * @note Each thread remembers the last chunk it looked up, so that only queries changing chunk hash.
+     */
+    const SandboxScene* findChunk(const size_t slot) const;
+    /**
+     * Position of a voxel relative to the chunk containing it.
+     */
+    static inline VoxelPosition toChunk(const VoxelPosition& p) {
+        return VoxelPosition(p.x % CHUNK_SIDE_SIZE, p.y, p.z % CHUNK_SIDE_SIZE);
+    }
+    /**
+     * Extends the world to a chunk and checks its height.
+     * @param   position    Position of the chunk in the world.
+     * @param   empty       True if the chunk does not contain any box.
+     * @param   chunk_height    Height of the chunk in voxels.
+     * @return  False if the chunk is empty and must not be stored.
+     */
+    bool placeChunk(const ChunkPosition& position, const bool empty, const int chunk_height);
+    /**
+     * Fills index if the stored chunks are dense enough in the bounding rectangle of the world.
+     */
+    void buildIndex();
+
+public:
+    // Constructors
+    /**
+     * World constructor loading every chunk of a region file, or every chunk JSON and region file of a folder.
+     * @note Every chunk holding a box must have the same height.
+     *       Chunks are decoded in parallel on the pool, then stored one after the other in the order of the files.
+     * @param   worldPath       Region file or folder containing the chunk files.
+     * @param   block_shapes    AABB of every block state.
+     *       With a cache budget, chunks are only decoded to find their position and dropped, rays then read them
+     *       again through a ChunkCache. A streaming world must be traced by a single thread.
+     * @param   pool            Workers decoding the chunks.
+     * @param   lazy_sections   Keeps the sections of region files packed until a ray reads them.
+     * @param   cache_budget    Memory the chunks may use in bytes, 0 keeps every chunk in memory.
+     *                          block_shapes must then outlive the world.
+     * @param   dedup_sections  Makes identical dense sections share their voxels, ignored by streaming worlds.
+     * @param   voxel_layout    Order of the voxels of the sections, set before they are deduplicated.
+     */
+    World(const std::string& worldPath, const BlockShapes& block_shapes, ThreadPool& pool,
+          const bool lazy_sections=false, const size_t cache_budget=0, const bool dedup_sections=false,
+          const VoxelLayout voxel_layout=VoxelLayout::ROW_MAJOR);
+    World(const World&) = delete;
+    World& operator=(const World&) = delete;
+    ~World();
+
+    // Methods
+    /**
+     * Getter for the shape identifier of a voxel in the world.
+     * @param   position    Position of the requested voxel, must be in bounds.
+     * @return  Identifier in the shape table, EMPTY_SHAPE in absent chunks.
+     */
+    inline ShapeId getShapeId(const VoxelPosition& position) const {
+        const SandboxScene* chunk = chunkAt(position);
+        return chunk ? chunk->getShapeId(toChunk(position)) : (ShapeId)EMPTY_SHAPE;
+    }
+    /**
+     * Getter for a voxel in the world given a position.
+     * @param   position    Position of the requested voxel, must be in bounds.
+     * @return  Voxel view over the boxes found at that given position.
+     */
+    inline Voxel getVoxel(const VoxelPosition& position) const {
+        return Voxel(shapes->getShape(getShapeId(position)));
+    }
+    /**
+     * Tests if a voxel contains any AABB using the occupancy masks only.
+     * @param   position    Position of the voxel to test.
+     * @return  True if the voxel is not empty, positions outside of the world are empty.
+     */
+    inline bool isOccupied(const VoxelPosition& position) const {
+        if (!inBounds(position))
+            return false;
+        const SandboxScene* chunk = chunkAt(position);
+        return chunk && chunk->isOccupied(toChunk(position));
+    }
+    /**
+     * Looks for a box of voxels around a position that is known to be empty.
+     * @note Absent and empty chunks are crossed as a whole, empty sections otherwise.
+     * @param   position    Position inside the world.
+     * @param   min         Set to the lowest voxel of the region if one is found.
+     * @param   max         Set to the highest voxel of the region if one is found.
+     * @return  True if the position is in an empty chunk or section.
+     */
+    inline bool findEmptyRegion(const VoxelPosition& position, VoxelPosition& min, VoxelPosition& max) const {
+        const VoxelPosition corner(position.x / CHUNK_SIDE_SIZE * CHUNK_SIDE_SIZE, 0,
+                                   position.z / CHUNK_SIDE_SIZE * CHUNK_SIDE_SIZE);
+        const SandboxScene* chunk = chunkAt(position);
+        if (!chunk) {
+            min = corner;
+            max = VoxelPosition(corner.x + CHUNK_SIDE_SIZE-1, height-1, corner.z + CHUNK_SIDE_SIZE-1);
+            return true;
+        }
+        if (!chunk->findEmptyRegion(toChunk(position), min, max))
+            return false;
+        min = VoxelPosition(min.x + corner.x, min.y, min.z + corner.z);
+        max = VoxelPosition(max.x + corner.x, max.y, max.z + corner.z);
+        return true;
+    }
+    /**
+     * Getter for the shape table of the world.
+     * @return  Const reference to the table.
+     */
+    inline const ShapeTable& getShapes() const {
+        return *shapes;
+    }
+    /**
+     * Amount of chunks holding at least one box.
+     */
+    size_t chunkCount() const;
+    /**
+     * Tells if the chunks are streamed through a cache.
+     */
+    inline bool isStreaming() const {
+        return (bool)cache;
+    }
+    /**
+     * Counters of the chunk cache of a streaming world.
+     * @return  The counters, all 0 if the world is not streaming.
+     */
+    ChunkCacheStats cacheStats() const;
+    /**
+     * Amount of chunks read without any box, they are not stored.
+     */
+    inline size_t emptyChunkCount() const {
+        return empty_chunks;
+    }
+    /**
+     * Amount of lazy sections that no ray has read yet.
+     */
+    size_t packedSectionCount() const;
+    /**
+     * Counters of the deduplication of the sections done while loading the world.
+     */
+    inline const DedupStats& dedupStats() const {
+        return dedup_stats;
+    }
+    /**
+     * Approximation of the memory used by the world (chunks, index and shape table).
+     * @return  Size in bytes.
+     */
+    size_t memoryUsage() const;
+    /**
+     * Getters for the dimensions of the world in voxels.
+     */
+    inline int sizeX() const { return chunks_x*CHUNK_SIDE_SIZE; }
+    inline int sizeY() const { return height; }
+    inline int sizeZ() const { return chunks_z*CHUNK_SIDE_SIZE; }
+    /**
+     * Dimensions of the world as a point, the world spans from the origin to this point.
+     */
+    inline Point extent() const {
+        return Point(sizeX(), sizeY(), sizeZ());
+    }
+    /**
+     * Getter for the revision of the voxels of the world, see SandboxScene::revision.
+     */
+    inline uint64_t revision() const {
+        return world_revision;
+    }
+    /**
+     * Checks if a voxel position is inside the world.
+     * @param   p   Position to check.
+     * @return  True if the position can be used with getVoxel.
+     */
+    inline bool inBounds(const VoxelPosition& p) const {
+        return p.x >= 0 && p.y >= 0 && p.z >= 0
+            && p.x < sizeX() && p.y < height && p.z < sizeZ();
+    }
+    /**
+     * Checks if a point is strictly inside the world.
+     * @param   p   Point to check.
+     * @return  True if the point is inside the world.
+     */
+    inline bool inBounds(const Point& p) const {
+        return p.x() > 0. && p.y() > 0. && p.z() > 0.
+            && p.x() < sizeX() && p.y() < height && p.z() < sizeZ();
+    }
+};
+
+#endif//__RAYCAST_WORLD__
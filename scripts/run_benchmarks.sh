@@ -37,3 +37,32 @@ do
     $SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/superflat_sandstone_chunk.json -s 3 --algorithm bitmask_marching --step $step --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
 done
 
+# DDA
+echo "Benchmarking dda"
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/test_world_chunk.json -s 4 --algorithm dda --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/superflat_sandstone_chunk.json -s 3 --algorithm dda --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+
+# SIMD slabs
+echo "Benchmarking simd slabs"
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/test_world_chunk.json -s 4 --algorithm slabs_simd --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/superflat_sandstone_chunk.json -s 3 --algorithm slabs_simd --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+
+# Sparse voxel octree
+echo "Benchmarking svo"
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/test_world_chunk.json -s 4 --algorithm svo --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/superflat_sandstone_chunk.json -s 3 --algorithm svo --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+
+# Brickmap
+echo "Benchmarking brickmap"
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/test_world_chunk.json -s 4 --algorithm brickmap --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/superflat_sandstone_chunk.json -s 3 --algorithm brickmap --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+
+# Distance field marching, the step size sweep is not needed
+echo "Benchmarking distance marching"
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/test_world_chunk.json -s 4 --algorithm distance_marching --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/superflat_sandstone_chunk.json -s 3 --algorithm distance_marching --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+
+# Sub-voxel occupancy masks
+echo "Benchmarking subvoxel"
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/test_world_chunk.json -s 4 --algorithm subvoxel --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
+$SCRIPT_DIR/../build/raycast -c $SCRIPT_DIR/../voxels/superflat_sandstone_chunk.json -s 3 --algorithm subvoxel --benchmark -o $SCRIPT_DIR/benchmark_plots/data/
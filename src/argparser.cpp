@@ -7,16 +7,26 @@
 #include <filesystem>
 #include <cassert>
 #include <cstring>
+#include <algorithm>
 #include <array>
+#include <thread>
+
+#include "scene_file.hpp"
 
 /**
  * Lookup table used to convert a RayAlgorithms enum item to string.
  */
-std::array<std::string, 4> ray_algorithms_lookup({
+std::array<std::string, 10> ray_algorithms_lookup({
     "slabs",
     "slabs_marching",
     "bitmask",
-    "bitmask_marching"
+    "bitmask_marching",
+    "dda",
+    "slabs_simd",
+    "svo",
+    "brickmap",
+    "distance_marching",
+    "subvoxel"
 });
 
 std::ostream& operator<<(std::ostream& os, const RayAlgorithms& a) {
@@ -28,9 +38,38 @@ std::string convert_to_string(const RayAlgorithms& a) {
     return ray_algorithms_lookup[a];
 }
 
+/**
+ * Lookup table used to convert a BenchModes enum item to string.
+ */
+std::array<std::string, 14> bench_modes_lookup({
+    "none",
+    "layout",
+    "trace",
+    "dispatch",
+    "packet",
+    "parser",
+    "load",
+    "lazy",
+    "cache",
+    "svo",
+    "brickmap",
+    "distance",
+    "morton",
+    "subvoxel"
+});
+
+std::ostream& operator<<(std::ostream& os, const BenchModes& b) {
+    os << bench_modes_lookup[b];
+    return os;
+}
+
+std::string convert_to_string(const BenchModes& b) {
+    return bench_modes_lookup[b];
+}
+
 
 ArgParser::ArgParser(const int argc, const char** argv)
-: chunkPath(""), shapesPath(BLOCK_SHAPES_FILE_PATH), section(0), ray_algorithm(RayAlgorithms::SLABS), marching_step(0.1), verbose(false), benchmark(false), output_folder(".") {
+: chunkPath(""), shapesPath(BLOCK_SHAPES_FILE_PATH), section(0), full_chunk(false), ray_algorithm(RayAlgorithms::SLABS), marching_step(0.1), verbose(false), benchmark(false), bench_mode(BenchModes::BENCH_NONE), record_trace(false), packet_width(8), brick_size(8), thread_count(std::max(1, (int)std::thread::hardware_concurrency())), lazy_sections(false), cache_budget(0), dedup_sections(false), morton_layout(false), convert_path(""), output_folder(".") {
     // Iterate on the arguments
     for (int i=1; i<argc; ++i) {
         if (!std::strcmp(argv[i], "--verbose")) {
@@ -39,6 +78,135 @@ ArgParser::ArgParser(const int argc, const char** argv)
         } else if (!std::strcmp(argv[i], "--benchmark")) {
             // --benchmark
             benchmark = true;
+        } else if (!std::strcmp(argv[i], "--dedup")) {
+            // --dedup
+            dedup_sections = true;
+        } else if (!std::strcmp(argv[i], "--morton")) {
+            // --morton
+            morton_layout = true;
+        } else if (!std::strcmp(argv[i], "--full-chunk")) {
+            // --full-chunk
+            full_chunk = true;
+        } else if (!std::strcmp(argv[i], "--lazy")) {
+            // --lazy
+            lazy_sections = true;
+        } else if (!std::strcmp(argv[i], "--record-trace")) {
+            // --record-trace
+            record_trace = true;
+        } else if (!std::strcmp(argv[i], "--bench")) {
+            // --bench
+            if (i+1 == argc) {
+                std::cout << "Missing benchmark name after the --bench argument\n";
+                exit(-1);
+            }
+            if (!strcmp(argv[i+1], "layout"))
+                bench_mode = BenchModes::BENCH_LAYOUT;
+            else if (!strcmp(argv[i+1], "trace"))
+                bench_mode = BenchModes::BENCH_TRACE;
+            else if (!strcmp(argv[i+1], "dispatch"))
+                bench_mode = BenchModes::BENCH_DISPATCH;
+            else if (!strcmp(argv[i+1], "packet"))
+                bench_mode = BenchModes::BENCH_PACKET;
+            else if (!strcmp(argv[i+1], "parser"))
+                bench_mode = BenchModes::BENCH_PARSER;
+            else if (!strcmp(argv[i+1], "load"))
+                bench_mode = BenchModes::BENCH_LOAD;
+            else if (!strcmp(argv[i+1], "lazy"))
+                bench_mode = BenchModes::BENCH_LAZY;
+            else if (!strcmp(argv[i+1], "cache"))
+                bench_mode = BenchModes::BENCH_CACHE;
+            else if (!strcmp(argv[i+1], "svo"))
+                bench_mode = BenchModes::BENCH_SVO;
+            else if (!strcmp(argv[i+1], "brickmap"))
+                bench_mode = BenchModes::BENCH_BRICKMAP;
+            else if (!strcmp(argv[i+1], "distance"))
+                bench_mode = BenchModes::BENCH_DISTANCE;
+            else if (!strcmp(argv[i+1], "morton"))
+                bench_mode = BenchModes::BENCH_MORTON;
+            else if (!strcmp(argv[i+1], "subvoxel"))
+                bench_mode = BenchModes::BENCH_SUBVOXEL;
+            else {
+                std::cout << "Bad benchmark name after the --bench argument\n";
+                exit(-1);
+            }
+            ++i;
+        } else if (!std::strcmp(argv[i], "--packet-width")) {
+            // --packet-width
+            if (i+1 == argc) {
+                std::cout << "Missing packet width after the --packet-width argument\n";
+                exit(-1);
+            }
+            if (!strcmp(argv[i+1], "4"))
+                packet_width = 4;
+            else if (!strcmp(argv[i+1], "8"))
+                packet_width = 8;
+            else {
+                std::cout << "Bad argument provided to --packet-width. Please provide 4 or 8.\n";
+                exit(-1);
+            }
+            ++i;
+        } else if (!std::strcmp(argv[i], "--brick-size")) {
+            // --brick-size
+            if (i+1 == argc) {
+                std::cout << "Missing brick size after the --brick-size argument\n";
+                exit(-1);
+            }
+            if (!strcmp(argv[i+1], "4"))
+                brick_size = 4;
+            else if (!strcmp(argv[i+1], "8"))
+                brick_size = 8;
+            else {
+                std::cout << "Bad argument provided to --brick-size. Please provide 4 or 8.\n";
+                exit(-1);
+            }
+            ++i;
+        } else if (!std::strcmp(argv[i], "--threads")) {
+            // --threads
+            if (i+1 == argc) {
+                std::cout << "Missing thread count after the --threads argument\n";
+                exit(-1);
+            }
+            try {
+                thread_count = std::stoi(argv[i+1]);
+            } catch (std::invalid_argument const& e) {
+                std::cout << "Bad argument provided to --threads. Please provide an integer.\n";
+                exit(-1);
+            }
+            if (thread_count < 1) {
+                std::cout << "Bad argument provided to --threads. Please provide at least 1 thread.\n";
+                exit(-1);
+            }
+            ++i;
+        } else if (!std::strcmp(argv[i], "--cache")) {
+            // --cache
+            if (i+1 == argc) {
+                std::cout << "Missing memory budget after the --cache argument\n";
+                exit(-1);
+            }
+            double megabytes = 0.;
+            try {
+                megabytes = std::stod(argv[i+1]);
+            } catch (std::invalid_argument const& e) {
+                std::cout << "Bad argument provided to --cache. Please provide a size in megabytes.\n";
+                exit(-1);
+            }
+            if (megabytes <= 0.) {
+                std::cout << "Bad argument provided to --cache. Please provide a positive size in megabytes.\n";
+                exit(-1);
+            }
+            cache_budget = (size_t)(megabytes*1024*1024);
+            ++i;
+        } else if (!std::strcmp(argv[i], "--convert")) {
+            // --convert
+            if (i+1 == argc) {
+                std::cout << "Missing scene file path after the --convert argument\n";
+                exit(-1);
+            } else if (argv[i+1][0] == '-') {
+                std::cout << "Missing scene file path after the --convert argument\n";
+                exit(-1);
+            }
+            convert_path = argv[i+1];
+            ++i;
         } else if (!std::strcmp(argv[i], "--output") || !std::strcmp(argv[i], "-o")) {
             // --output
             if (i+1 == argc) {
@@ -102,6 +270,18 @@ ArgParser::ArgParser(const int argc, const char** argv)
                 ray_algorithm = RayAlgorithms::BITMASK;
             else if (!strcmp(argv[i+1], "bitmask_marching"))
                 ray_algorithm = RayAlgorithms::BITMASK_MARCHING;
+            else if (!strcmp(argv[i+1], "dda"))
+                ray_algorithm = RayAlgorithms::DDA;
+            else if (!strcmp(argv[i+1], "slabs_simd"))
+                ray_algorithm = RayAlgorithms::SLABS_SIMD;
+            else if (!strcmp(argv[i+1], "svo"))
+                ray_algorithm = RayAlgorithms::SVO;
+            else if (!strcmp(argv[i+1], "brickmap"))
+                ray_algorithm = RayAlgorithms::BRICKMAP;
+            else if (!strcmp(argv[i+1], "distance_marching"))
+                ray_algorithm = RayAlgorithms::DISTANCE_MARCHING;
+            else if (!strcmp(argv[i+1], "subvoxel"))
+                ray_algorithm = RayAlgorithms::SUBVOXEL;
             else {
                 std::cout << "Bad algorithm name after the --algorithm,-a argument\n";
                 exit(-1);
@@ -132,7 +312,8 @@ ArgParser::ArgParser(const int argc, const char** argv)
     }
 
     assert(std::filesystem::exists(chunkPath));
-    assert(std::filesystem::exists(shapesPath));
+    // Binary scene files already contain their shapes
+    assert(isSceneFile(chunkPath) || std::filesystem::exists(shapesPath));
     assert(std::filesystem::exists(output_folder));
     // assert(section >= -4 && section <= 15);
     // The Wiki is unclear about these values, maybe they are false
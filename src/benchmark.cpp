@@ -0,0 +1,937 @@
+/**
+ * @file benchmark.cpp
+ */
+#include "benchmark.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+#include <json/json.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "ray.hpp"
+#include "ray_algorithm.hpp"
+#include "packet.hpp"
+#include "util.hpp"
+#include "thread_pool.hpp"
+#include "chunk_cache.hpp"
+
+/**
+ * Input of a single slab step: the ray head and the voxel it is entering.
+ */
+struct RecordedStep {
+    Point origin;
+    Point direction;
+    VoxelPosition tile;
+};
+
+/**
+ * Replays recorded steps by fetching each voxel through the given accessor and testing its boxes.
+ * @param   steps   Steps to replay.
+ * @param   fetch   Callable returning the Voxel at a VoxelPosition.
+ * @return  Amount of boxes hit, only used to prevent the compiler from removing the loop.
+ */
+template<typename Fetch>
+static size_t replaySteps(const std::vector<RecordedStep>& steps, Fetch fetch) {
+    size_t hits = 0;
+    for (const RecordedStep& s : steps) {
+        const Point origin_relative = s.origin - Point(s.tile.x, s.tile.y, s.tile.z);
+        for (const AABB& box : fetch(s.tile).getContents()) {
+            double distance;
+            hits += slabsRayHitsBox(origin_relative, s.direction, box, distance);
+        }
+    }
+    return hits;
+}
+
+void benchmarkLayout(const SandboxScene& scene, const ArgParser& args) {
+    constexpr int repetitions = 50;
+
+    // Record the steps done by the slab algorithm for every ray
+    std::vector<RecordedStep> steps;
+    SlabAlgorithm algorithm;
+    Ray ray(Point(), Point(1., 0., 0.), args.record_trace);
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i) {
+        ray.reset(BENCHMARK_INITIAL_SEED+i, scene.extent());
+        Point ray_pos = ray.getOrigin();
+        bool found_inter = false;
+        while (scene.inBounds(ray_pos) && !found_inter) {
+            const VoxelPosition tile(ray_pos + ray.getDirection()*RAY_NUDGE);
+            if (scene.inBounds(tile))
+                steps.push_back({ray_pos, ray.getDirection(), tile});
+            found_inter = algorithm.computeStep(ray, scene);
+            ray_pos = ray.getLastTracePoint();
+        }
+    }
+
+    // Copy the scene into the legacy nested layout, every voxel owning a vector of its boxes
+    Lattice3D<std::vector<AABB>> nested(scene.sizeY(), std::vector<std::vector<std::vector<AABB>>>(scene.sizeZ(),
+                                        std::vector<std::vector<AABB>>(scene.sizeX())));
+    for (int y=0; y<scene.sizeY(); ++y)
+        for (int z=0; z<scene.sizeZ(); ++z)
+            for (int x=0; x<scene.sizeX(); ++x) {
+                const Voxel voxel = scene.getVoxel(VoxelPosition(x, y, z));
+                nested[y][z][x].assign(voxel.begin(), voxel.end());
+            }
+
+    if (args.verbose)
+        std::cout << "[+] Replaying " << steps.size() << " recorded steps " << repetitions << " times per layout\n";
+
+    size_t sink = 0;
+    const auto t_nested_start = std::chrono::high_resolution_clock::now();
+    for (int r=0; r<repetitions; ++r)
+        sink += replaySteps(steps, [&nested](const VoxelPosition& p) {
+            return Voxel(nested[p.y][p.z][p.x]);
+        });
+    const auto t_nested_end = std::chrono::high_resolution_clock::now();
+
+    const auto t_flat_start = std::chrono::high_resolution_clock::now();
+    for (int r=0; r<repetitions; ++r)
+        sink += replaySteps(steps, [&scene](const VoxelPosition& p) {
+            return scene.getVoxel(p);
+        });
+    const auto t_flat_end = std::chrono::high_resolution_clock::now();
+
+    // Steps per second for both layouts
+    const double total_steps = (double)steps.size()*repetitions;
+    const double nested_time = std::chrono::duration<double>(t_nested_end - t_nested_start).count();
+    const double flat_time = std::chrono::duration<double>(t_flat_end - t_flat_start).count();
+
+    const std::string output_filename = args.output_folder+'/'
+        +"layout_"+std::filesystem::path(args.chunkPath).stem().string()+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "layout;steps;seconds;steps_per_second\n";
+    output << "nested;" << total_steps << ';' << nested_time << ';' << total_steps/nested_time << '\n';
+    output << "flat;" << total_steps << ';' << flat_time << ';' << total_steps/flat_time << '\n';
+
+    std::cout << "nested: " << total_steps/nested_time << " steps/s\n";
+    std::cout << "flat:   " << total_steps/flat_time << " steps/s\n";
+    if (args.verbose)
+        std::cout << "[+] Layout benchmark written to " << output_filename << " (" << sink << " hits)\n";
+}
+
+template<VoxelScene Scene>
+void benchmarkTrace(const Scene& scene, RayAlgorithm& algorithm, const ArgParser& args) {
+    const std::string output_filename = args.output_folder+'/'
+        +"trace_"+std::filesystem::path(args.chunkPath).stem().string()+'_'
+        +std::to_string(BENCHMARK_RAY_AMOUNT)+'_'+convert_to_string(args.ray_algorithm)
+        +((args.ray_algorithm == RayAlgorithms::SLABS_MARCHING
+          || args.ray_algorithm == RayAlgorithms::BITMASK_MARCHING)
+          ? '_'+std::to_string(args.marching_step) : "") +".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+
+    // Acceleration structures are built beforehand so that only the traversal is measured
+    algorithm.prepare(scene);
+    Ray ray(Point(), Point(1., 0., 0.), args.record_trace);
+    double total_time = 0.;
+    int hits = 0;
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i) {
+        ray.reset(BENCHMARK_INITIAL_SEED+i, scene.extent());
+        output << ray.getOrigin() << ';' << ray.getDirection() << '|';
+
+        const auto t_start = std::chrono::high_resolution_clock::now();
+        const Hit hit = algorithm.traceRay(ray, scene);
+        const auto t_end = std::chrono::high_resolution_clock::now();
+        const double time = std::chrono::duration<double, std::chrono::microseconds::period>(t_end - t_start).count();
+        total_time += time;
+        hits += hit.found;
+
+        output << hit.found << ';' << hit.distance << ';'
+               << hit.voxel.x << ',' << hit.voxel.y << ',' << hit.voxel.z << ';'
+               << hit.box << ';' << hit.normal << ';' << time << '\n';
+    }
+
+    std::cout << convert_to_string(args.ray_algorithm) << ": "
+              << BENCHMARK_RAY_AMOUNT/(total_time*1e-6) << " rays/s, " << hits << " hits\n";
+    if (args.verbose)
+        std::cout << "[+] Trace benchmark written to " << output_filename << '\n';
+}
+
+template void benchmarkTrace<SandboxScene>(const SandboxScene&, RayAlgorithm&, const ArgParser&);
+template void benchmarkTrace<World>(const World&, RayAlgorithm&, const ArgParser&);
+
+template<typename Algorithm, VoxelScene Scene>
+void benchmarkDispatch(const Scene& scene, Algorithm& algorithm, const ArgParser& args) {
+    constexpr int repetitions = 5;
+    RayAlgorithm& virtual_algorithm = algorithm;
+    int hits_step = 0, hits_virtual = 0, hits_static = 0;
+
+    // Generate the rays and acceleration structures beforehand so that only the traversal is measured
+    algorithm.prepare(scene);
+    std::vector<Ray> rays(BENCHMARK_RAY_AMOUNT, Ray(Point(), Point(1., 0., 0.), args.record_trace));
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i)
+        rays[i].reset(BENCHMARK_INITIAL_SEED+i, scene.extent());
+
+    // Virtual call for every step, like the --benchmark loop
+    const auto t_step_start = std::chrono::high_resolution_clock::now();
+    for (int r=0; r<repetitions; ++r) {
+        for (Ray& ray : rays) {
+            ray.clearTrace();
+            Point ray_pos = ray.getOrigin();
+            bool found_inter = false;
+            while (scene.inBounds(ray_pos) && !found_inter) {
+                found_inter = virtual_algorithm.computeStep(ray, scene);
+                ray_pos = ray.getLastTracePoint();
+            }
+            hits_step += found_inter;
+        }
+    }
+    const auto t_step_end = std::chrono::high_resolution_clock::now();
+
+    // Virtual call for every ray
+    const auto t_virtual_start = std::chrono::high_resolution_clock::now();
+    for (int r=0; r<repetitions; ++r) {
+        for (Ray& ray : rays) {
+            ray.clearTrace();
+            hits_virtual += virtual_algorithm.traceRay(ray, scene).found;
+        }
+    }
+    const auto t_virtual_end = std::chrono::high_resolution_clock::now();
+
+    // Static dispatch
+    const auto t_static_start = std::chrono::high_resolution_clock::now();
+    for (int r=0; r<repetitions; ++r) {
+        for (Ray& ray : rays) {
+            ray.clearTrace();
+            hits_static += traceRayStatic(algorithm, ray, scene).found;
+        }
+    }
+    const auto t_static_end = std::chrono::high_resolution_clock::now();
+
+    const double total_rays = (double)BENCHMARK_RAY_AMOUNT*repetitions;
+    const double step_rate = total_rays/std::chrono::duration<double>(t_step_end - t_step_start).count();
+    const double virtual_rate = total_rays/std::chrono::duration<double>(t_virtual_end - t_virtual_start).count();
+    const double static_rate = total_rays/std::chrono::duration<double>(t_static_end - t_static_start).count();
+
+    const std::string output_filename = args.output_folder+'/'
+        +"dispatch_"+std::filesystem::path(args.chunkPath).stem().string()+'_'
+        +convert_to_string(args.ray_algorithm)+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "algorithm;virtual_step;virtual_ray;static\n";
+    output << args.ray_algorithm << ';' << step_rate << ';' << virtual_rate << ';' << static_rate << '\n';
+
+    std::cout << "rays/s        virtual step  virtual ray   static\n";
+    std::cout << args.ray_algorithm << "\t" << step_rate << "\t" << virtual_rate << "\t" << static_rate << '\n';
+    if (hits_step != hits_static || hits_virtual != hits_static)
+        std::cout << "[!] Hit counts differ: " << hits_step << ' ' << hits_virtual << ' ' << hits_static << '\n';
+    if (args.verbose)
+        std::cout << "[+] Dispatch benchmark written to " << output_filename << '\n';
+}
+
+template void benchmarkDispatch<SlabAlgorithm, SandboxScene>(const SandboxScene&, SlabAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<MarchingSlabAlgorithm, SandboxScene>(const SandboxScene&, MarchingSlabAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<BitmaskAlgorithm, SandboxScene>(const SandboxScene&, BitmaskAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<MarchingBitmaskAlgorithm, SandboxScene>(const SandboxScene&, MarchingBitmaskAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<DDAAlgorithm, SandboxScene>(const SandboxScene&, DDAAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<SimdSlabAlgorithm, SandboxScene>(const SandboxScene&, SimdSlabAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<SvoAlgorithm, SandboxScene>(const SandboxScene&, SvoAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<BrickmapAlgorithm, SandboxScene>(const SandboxScene&, BrickmapAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<DistanceMarchingAlgorithm, SandboxScene>(const SandboxScene&, DistanceMarchingAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<SubvoxelAlgorithm, SandboxScene>(const SandboxScene&, SubvoxelAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<SlabAlgorithm, World>(const World&, SlabAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<MarchingSlabAlgorithm, World>(const World&, MarchingSlabAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<BitmaskAlgorithm, World>(const World&, BitmaskAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<MarchingBitmaskAlgorithm, World>(const World&, MarchingBitmaskAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<DDAAlgorithm, World>(const World&, DDAAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<SimdSlabAlgorithm, World>(const World&, SimdSlabAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<SvoAlgorithm, World>(const World&, SvoAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<BrickmapAlgorithm, World>(const World&, BrickmapAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<DistanceMarchingAlgorithm, World>(const World&, DistanceMarchingAlgorithm&, const ArgParser&);
+template void benchmarkDispatch<SubvoxelAlgorithm, World>(const World&, SubvoxelAlgorithm&, const ArgParser&);
+
+/**
+ * Packet benchmark for a given packet width, see benchmarkPacket.
+ */
+template<int Width>
+static void benchmarkPacketWidth(const SandboxScene& scene, const ArgParser& args) {
+    constexpr int packet_amount = BENCHMARK_RAY_AMOUNT/Width;
+    constexpr int columns = Width/2;
+
+    // Each packet is a 2 rows tile of a pinhole camera shot from a random ray
+    std::vector<Ray> rays;
+    rays.reserve(packet_amount*Width);
+    Ray camera(Point(), Point(1., 0., 0.));
+    for (int p=0; p<packet_amount; ++p) {
+        camera.reset(BENCHMARK_INITIAL_SEED+p, scene.extent());
+        const Point forward = camera.getDirection();
+        Point right = forward.cross(std::abs(forward.y()) < 0.99 ? Point(0., 1., 0.) : Point(1., 0., 0.));
+        right /= right.norm2();
+        const Point up = right.cross(forward);
+        for (int lane=0; lane<Width; ++lane) {
+            const double u = (lane%columns - (columns-1)/2.)*BENCHMARK_PACKET_SPREAD;
+            const double v = (lane/columns - .5)*BENCHMARK_PACKET_SPREAD;
+            Point direction = forward + right*u + up*v;
+            direction /= direction.norm2();
+            rays.emplace_back(camera.getOrigin(), direction);
+        }
+    }
+
+    // Scalar reference
+    DDAAlgorithm algorithm;
+    std::vector<Hit> scalar_hits(rays.size());
+    const auto t_scalar_start = std::chrono::high_resolution_clock::now();
+    for (size_t i=0; i<rays.size(); ++i)
+        scalar_hits[i] = traceRayStatic(algorithm, rays[i], scene);
+    const auto t_scalar_end = std::chrono::high_resolution_clock::now();
+
+    // Packets, timed as a whole like the scalar reference so that the clock is not read around every packet
+    PacketTracer<Width> tracer;
+    std::vector<Hit> packet_hits(rays.size());
+    const auto t_packet_start = std::chrono::high_resolution_clock::now();
+    for (int p=0; p<packet_amount; ++p)
+        tracer.tracePacket(std::span<const Ray, Width>(rays.data() + p*Width, Width), scene,
+                           std::span<Hit, Width>(packet_hits.data() + p*Width, Width));
+    const auto t_packet_end = std::chrono::high_resolution_clock::now();
+
+    const std::string output_filename = args.output_folder+'/'
+        +"packet_"+std::filesystem::path(args.chunkPath).stem().string()+'_'
+        +std::to_string(BENCHMARK_RAY_AMOUNT)+'_'+std::to_string(Width)+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+
+    // Rays are written with the average time of a packet ray
+    const double packet_time = std::chrono::duration<double, std::chrono::microseconds::period>(t_packet_end - t_packet_start).count();
+    const double time = packet_time/rays.size();
+    int mismatches = 0;
+    for (size_t i=0; i<rays.size(); ++i) {
+        const Hit& hit = packet_hits[i];
+        const Hit& reference = scalar_hits[i];
+        mismatches += hit.found != reference.found || hit.voxel != reference.voxel || hit.box != reference.box;
+
+        output << rays[i].getOrigin() << ';' << rays[i].getDirection() << '|'
+               << hit.found << ';' << hit.distance << ';'
+               << hit.voxel.x << ',' << hit.voxel.y << ',' << hit.voxel.z << ';'
+               << hit.box << ';' << hit.normal << ';' << time << '\n';
+    }
+
+    const double scalar_time = std::chrono::duration<double, std::chrono::microseconds::period>(t_scalar_end - t_scalar_start).count();
+    std::cout << "dda:      " << rays.size()/(scalar_time*1e-6) << " rays/s\n";
+    std::cout << "packet " << Width << ": " << rays.size()/(packet_time*1e-6) << " rays/s, "
+              << (double)tracer.getFetchCount()/rays.size() << " voxel fetches per ray\n";
+    if (mismatches)
+        std::cout << "[!] " << mismatches << " rays hit something else than with dda\n";
+    if (args.verbose)
+        std::cout << "[+] Packet benchmark written to " << output_filename << '\n';
+}
+
+void benchmarkPacket(const SandboxScene& scene, const ArgParser& args) {
+    if (args.packet_width == 4)
+        benchmarkPacketWidth<4>(scene, args);
+    else
+        benchmarkPacketWidth<8>(scene, args);
+}
+
+void benchmarkParser(const ArgParser& args) {
+    // Both parsers go through at least this amount of boxes
+    constexpr size_t min_boxes = 1000000;
+
+    // Every shape string of the block shapes file
+    std::ifstream shapesFile(args.shapesPath, std::ios_base::in);
+    Json::Value shapesData;
+    shapesFile >> shapesData;
+    std::vector<std::string> shape_strings;
+    for (const Json::Value& block : shapesData)
+        for (const Json::Value& state : block["states"])
+            shape_strings.push_back(state["shape"].asString());
+
+    // One warm-up pass to count the boxes of the file
+    std::vector<AABB> buffer;
+    size_t file_boxes = 0;
+    for (const std::string& s : shape_strings) {
+        str_to_aabbs(s, buffer);
+        file_boxes += buffer.size();
+    }
+    const size_t repetitions = std::max<size_t>(1, min_boxes/std::max<size_t>(1, file_boxes));
+    if (args.verbose)
+        std::cout << "[+] Parsing " << shape_strings.size() << " shapes (" << file_boxes << " boxes) "
+                  << repetitions << " times per parser\n";
+
+    size_t legacy_boxes = 0;
+    const auto t_legacy_start = std::chrono::high_resolution_clock::now();
+    for (size_t r=0; r<repetitions; ++r)
+        for (const std::string& s : shape_strings)
+            legacy_boxes += str_to_aabbvector(s).size();
+    const auto t_legacy_end = std::chrono::high_resolution_clock::now();
+
+    size_t boxes = 0;
+    int failures = 0;
+    const auto t_start = std::chrono::high_resolution_clock::now();
+    for (size_t r=0; r<repetitions; ++r) {
+        for (const std::string& s : shape_strings) {
+            failures += !str_to_aabbs(s, buffer);
+            boxes += buffer.size();
+        }
+    }
+    const auto t_end = std::chrono::high_resolution_clock::now();
+
+    const double legacy_rate = legacy_boxes/std::chrono::duration<double>(t_legacy_end - t_legacy_start).count();
+    const double rate = boxes/std::chrono::duration<double>(t_end - t_start).count();
+
+    const std::string output_filename = args.output_folder+'/'
+        +"parser_"+std::filesystem::path(args.shapesPath).stem().string()+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "parser;boxes;boxes_per_second\n";
+    output << "str_to_aabbvector;" << legacy_boxes << ';' << legacy_rate << '\n';
+    output << "str_to_aabbs;" << boxes << ';' << rate << '\n';
+
+    std::cout << "str_to_aabbvector: " << legacy_rate << " boxes/s\n";
+    std::cout << "str_to_aabbs:      " << rate << " boxes/s\n";
+    if (failures || boxes != legacy_boxes)
+        std::cout << "[!] Parsers disagree: " << failures << " malformed strings, "
+                  << legacy_boxes << " against " << boxes << " boxes\n";
+    if (args.verbose)
+        std::cout << "[+] Parser benchmark written to " << output_filename << '\n';
+}
+
+void benchmarkLoad(const ArgParser& args) {
+    const BlockShapes block_shapes(args.shapesPath);
+
+    std::vector<double> best_times;
+    size_t chunk_count = 0;
+    for (int threads=1; threads<=args.thread_count; ++threads) {
+        ThreadPool pool(threads);
+        double best = 0.;
+        for (int r=0; r<BENCHMARK_LOAD_REPETITIONS; ++r) {
+            const auto t_start = std::chrono::high_resolution_clock::now();
+            const World world(args.chunkPath, block_shapes, pool);
+            const auto t_end = std::chrono::high_resolution_clock::now();
+            const double time = std::chrono::duration<double, std::chrono::milliseconds::period>(t_end - t_start).count();
+            best = (r == 0) ? time : std::min(best, time);
+
+            // Every thread count must load the same world
+            if (threads == 1 && r == 0)
+                chunk_count = world.chunkCount();
+            else if (world.chunkCount() != chunk_count)
+                std::cout << "[!] " << threads << " threads loaded " << world.chunkCount() << " chunks instead of "
+                          << chunk_count << '\n';
+        }
+        best_times.push_back(best);
+        if (args.verbose)
+            std::cout << "[+] " << threads << " threads: " << best << "ms\n";
+    }
+
+    const std::string output_filename = args.output_folder+'/'
+        +"load_"+std::filesystem::path(args.chunkPath).stem().string()+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "threads;milliseconds;speedup\n";
+    for (size_t t=0; t<best_times.size(); ++t) {
+        output << t+1 << ';' << best_times[t] << ';' << best_times[0]/best_times[t] << '\n';
+        std::cout << t+1 << " threads: " << best_times[t] << "ms (x" << best_times[0]/best_times[t] << ")\n";
+    }
+    if (args.verbose)
+        std::cout << "[+] Load benchmark written to " << output_filename << '\n';
+}
+
+template<typename Algorithm>
+void benchmarkLazy(const World& world, Algorithm& algorithm, const ArgParser& args) {
+    // The chunk cache of a streaming world is not thread safe
+    ThreadPool pool(world.isStreaming() ? 1 : args.thread_count);
+    // The copies share the acceleration structures built once
+    algorithm.prepare(world);
+    std::vector<Algorithm> algorithms(pool.size(), algorithm);
+
+    std::vector<Ray> rays(BENCHMARK_RAY_AMOUNT, Ray(Point(), Point(1., 0., 0.), args.record_trace));
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i)
+        rays[i].reset(BENCHMARK_INITIAL_SEED+i, world.extent());
+
+    const std::string output_filename = args.output_folder+'/'
+        +"lazy_"+std::filesystem::path(args.chunkPath).stem().string()+'_'
+        +convert_to_string(args.ray_algorithm)+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "pass;milliseconds;rays_per_second;sections_materialized;materialize_milliseconds;packed_sections\n";
+
+    std::vector<Hit> hits(BENCHMARK_RAY_AMOUNT), first_hits;
+    int mismatches = 0;
+    for (int pass=0; pass<BENCHMARK_LAZY_PASSES; ++pass) {
+        const MaterializationStats stats_start = Section::getMaterializationStats();
+        const auto t_start = std::chrono::high_resolution_clock::now();
+        pool.parallelFor(rays.size(), [&](const size_t i, const int worker) {
+            rays[i].clearTrace();
+            hits[i] = traceRayStatic(algorithms[worker], rays[i], world);
+        });
+        const auto t_end = std::chrono::high_resolution_clock::now();
+        const MaterializationStats stats_end = Section::getMaterializationStats();
+
+        // Expanding a section must not change what the rays hit
+        if (pass == 0)
+            first_hits = hits;
+        for (size_t i=0; i<hits.size(); ++i)
+            mismatches += hits[i].found != first_hits[i].found || !(hits[i].voxel == first_hits[i].voxel)
+                       || hits[i].box != first_hits[i].box;
+
+        const double time = std::chrono::duration<double, std::chrono::milliseconds::period>(t_end - t_start).count();
+        const uint64_t sections = stats_end.sections - stats_start.sections;
+        const double materialize_time = (stats_end.nanoseconds - stats_start.nanoseconds)*1e-6;
+        const size_t packed_sections = world.packedSectionCount();
+        output << pass << ';' << time << ';' << BENCHMARK_RAY_AMOUNT/(time*1e-3) << ';' << sections << ';'
+               << materialize_time << ';' << packed_sections << '\n';
+        std::cout << "pass " << pass << ": " << time << "ms, " << BENCHMARK_RAY_AMOUNT/(time*1e-3) << " rays/s, "
+                  << sections << " sections materialized in " << materialize_time << "ms, "
+                  << packed_sections << " still packed\n";
+    }
+
+    if (mismatches)
+        std::cout << "[!] " << mismatches << " hits differ from the first pass\n";
+    if (args.verbose)
+        std::cout << "[+] Lazy benchmark written to " << output_filename << '\n';
+}
+
+template void benchmarkLazy<SlabAlgorithm>(const World&, SlabAlgorithm&, const ArgParser&);
+template void benchmarkLazy<MarchingSlabAlgorithm>(const World&, MarchingSlabAlgorithm&, const ArgParser&);
+template void benchmarkLazy<BitmaskAlgorithm>(const World&, BitmaskAlgorithm&, const ArgParser&);
+template void benchmarkLazy<MarchingBitmaskAlgorithm>(const World&, MarchingBitmaskAlgorithm&, const ArgParser&);
+template void benchmarkLazy<DDAAlgorithm>(const World&, DDAAlgorithm&, const ArgParser&);
+template void benchmarkLazy<SimdSlabAlgorithm>(const World&, SimdSlabAlgorithm&, const ArgParser&);
+template void benchmarkLazy<SvoAlgorithm>(const World&, SvoAlgorithm&, const ArgParser&);
+template void benchmarkLazy<BrickmapAlgorithm>(const World&, BrickmapAlgorithm&, const ArgParser&);
+template void benchmarkLazy<DistanceMarchingAlgorithm>(const World&, DistanceMarchingAlgorithm&, const ArgParser&);
+template void benchmarkLazy<SubvoxelAlgorithm>(const World&, SubvoxelAlgorithm&, const ArgParser&);
+
+template<typename Algorithm>
+void benchmarkCache(const World& world, Algorithm& algorithm, const ArgParser& args) {
+    if (!world.isStreaming())
+        std::cout << "[!] The world is kept in memory, use --cache to stream it\n";
+
+    std::vector<Ray> rays(BENCHMARK_RAY_AMOUNT, Ray(Point(), Point(1., 0., 0.), args.record_trace));
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i)
+        rays[i].reset(BENCHMARK_INITIAL_SEED+i, world.extent());
+
+    // Building an acceleration structure reads every chunk, it is not counted in the cache statistics
+    algorithm.prepare(world);
+    const ChunkCacheStats stats_start = world.cacheStats();
+    int hits = 0;
+    const auto t_start = std::chrono::high_resolution_clock::now();
+    for (Ray& ray : rays)
+        hits += traceRayStatic(algorithm, ray, world).found;
+    const auto t_end = std::chrono::high_resolution_clock::now();
+    const ChunkCacheStats stats = world.cacheStats();
+
+    // The time spent waiting for missing chunks is reported apart from the traversal itself
+    const double time = std::chrono::duration<double, std::chrono::milliseconds::period>(t_end - t_start).count();
+    const double miss_time = (stats.miss_nanoseconds - stats_start.miss_nanoseconds)*1e-6;
+    const double rate = BENCHMARK_RAY_AMOUNT/(time*1e-3);
+    const double rate_without_misses = BENCHMARK_RAY_AMOUNT/((time - miss_time)*1e-3);
+
+    const std::string output_filename = args.output_folder+'/'
+        +"cache_"+std::filesystem::path(args.chunkPath).stem().string()+'_'
+        +convert_to_string(args.ray_algorithm)+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "budget_bytes;milliseconds;miss_milliseconds;rays_per_second;rays_per_second_without_misses;"
+           << "hits;misses;evictions;prefetches;prefetch_hits;resident_chunks;resident_bytes\n";
+    output << args.cache_budget << ';' << time << ';' << miss_time << ';' << rate << ';' << rate_without_misses << ';'
+           << stats.hits - stats_start.hits << ';' << stats.misses - stats_start.misses << ';'
+           << stats.evictions - stats_start.evictions << ';' << stats.prefetches - stats_start.prefetches << ';'
+           << stats.prefetch_hits - stats_start.prefetch_hits << ';' << stats.resident_chunks << ';'
+           << stats.resident_bytes << '\n';
+
+    std::cout << convert_to_string(args.ray_algorithm) << ": " << rate << " rays/s, " << rate_without_misses
+              << " rays/s without the " << miss_time << "ms of misses, " << hits << " hits\n";
+    std::cout << "cache: " << stats.hits - stats_start.hits << " hits, " << stats.misses - stats_start.misses
+              << " misses, " << stats.evictions - stats_start.evictions << " evictions, "
+              << stats.prefetches - stats_start.prefetches << " prefetches (" << stats.prefetch_hits - stats_start.prefetch_hits
+              << " used), " << stats.resident_chunks << " chunks in " << stats.resident_bytes << " bytes\n";
+    if (args.verbose)
+        std::cout << "[+] Cache benchmark written to " << output_filename << '\n';
+}
+
+template void benchmarkCache<SlabAlgorithm>(const World&, SlabAlgorithm&, const ArgParser&);
+template void benchmarkCache<MarchingSlabAlgorithm>(const World&, MarchingSlabAlgorithm&, const ArgParser&);
+template void benchmarkCache<BitmaskAlgorithm>(const World&, BitmaskAlgorithm&, const ArgParser&);
+template void benchmarkCache<MarchingBitmaskAlgorithm>(const World&, MarchingBitmaskAlgorithm&, const ArgParser&);
+template void benchmarkCache<DDAAlgorithm>(const World&, DDAAlgorithm&, const ArgParser&);
+template void benchmarkCache<SimdSlabAlgorithm>(const World&, SimdSlabAlgorithm&, const ArgParser&);
+template void benchmarkCache<SvoAlgorithm>(const World&, SvoAlgorithm&, const ArgParser&);
+template void benchmarkCache<BrickmapAlgorithm>(const World&, BrickmapAlgorithm&, const ArgParser&);
+template void benchmarkCache<DistanceMarchingAlgorithm>(const World&, DistanceMarchingAlgorithm&, const ArgParser&);
+template void benchmarkCache<SubvoxelAlgorithm>(const World&, SubvoxelAlgorithm&, const ArgParser&);
+
+/**
+ * Traces rays with a statically dispatched algorithm and counts their steps.
+ * @param   algorithm   Algorithm used to trace the rays.
+ * @param   rays        Rays to trace, their trace is cleared first.
+ * @param   scene       Scene to trace the rays in.
+ * @param   hits        Set to the result of every ray.
+ * @param   steps       Set to the total amount of steps of the rays.
+ * @return  Time spent tracing the rays in seconds.
+ */
+template<typename Algorithm, VoxelScene Scene>
+static double traceCountingSteps(Algorithm& algorithm, std::vector<Ray>& rays, const Scene& scene,
+                                 std::vector<Hit>& hits, size_t& steps) {
+    steps = 0;
+    const auto t_start = std::chrono::high_resolution_clock::now();
+    for (size_t i=0; i<rays.size(); ++i) {
+        rays[i].clearTrace();
+        hits[i] = traceRayStatic(algorithm, rays[i], scene);
+        steps += rays[i].getStepCount();
+    }
+    const auto t_end = std::chrono::high_resolution_clock::now();
+    return std::chrono::duration<double>(t_end - t_start).count();
+}
+
+template<VoxelScene Scene>
+void benchmarkSvo(const Scene& scene, const ArgParser& args) {
+    std::vector<Ray> rays(BENCHMARK_RAY_AMOUNT, Ray(Point(), Point(1., 0., 0.), args.record_trace));
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i)
+        rays[i].reset(BENCHMARK_INITIAL_SEED+i, scene.extent());
+
+    // The octree is built beforehand so that only the traversal is measured
+    SvoAlgorithm svo;
+    const auto t_build_start = std::chrono::high_resolution_clock::now();
+    svo.build(scene);
+    const auto t_build_end = std::chrono::high_resolution_clock::now();
+    const double build_time = std::chrono::duration<double, std::chrono::milliseconds::period>(t_build_end - t_build_start).count();
+    const SparseVoxelOctree& octree = svo.getOctree();
+
+    DDAAlgorithm dda;
+    std::vector<Hit> dda_hits(rays.size()), svo_hits(rays.size());
+    size_t dda_steps, svo_steps;
+    const double dda_time = traceCountingSteps(dda, rays, scene, dda_hits, dda_steps);
+    svo.resetStepCounts();
+    const double svo_time = traceCountingSteps(svo, rays, scene, svo_hits, svo_steps);
+
+    // Both traversals must hit the same boxes
+    int dda_found = 0, svo_found = 0, mismatches = 0;
+    for (size_t i=0; i<rays.size(); ++i) {
+        dda_found += dda_hits[i].found;
+        svo_found += svo_hits[i].found;
+        mismatches += dda_hits[i].found != svo_hits[i].found || !(dda_hits[i].voxel == svo_hits[i].voxel)
+                   || dda_hits[i].box != svo_hits[i].box;
+    }
+    const double octant_steps = (double)svo.octantSteps()/rays.size();
+    const double voxel_steps = (double)svo.voxelSteps()/rays.size();
+
+    const std::string output_filename = args.output_folder+'/'
+        +"svo_"+std::filesystem::path(args.chunkPath).stem().string()+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "algorithm;steps_per_ray;octant_steps_per_ray;voxel_steps_per_ray;rays_per_second;hits\n";
+    output << "dda;" << (double)dda_steps/rays.size() << ";0;" << (double)dda_steps/rays.size() << ';'
+           << rays.size()/dda_time << ';' << dda_found << '\n';
+    output << "svo;" << (double)svo_steps/rays.size() << ';' << octant_steps << ';' << voxel_steps << ';'
+           << rays.size()/svo_time << ';' << svo_found << '\n';
+    output << "build_milliseconds;depth;nodes;leaves;bytes\n";
+    output << build_time << ';' << octree.depth() << ';' << octree.nodeCount() << ';' << octree.leafCount() << ';'
+           << octree.memoryUsage() << '\n';
+
+    std::cout << "dda: " << (double)dda_steps/rays.size() << " steps/ray, " << rays.size()/dda_time << " rays/s\n";
+    std::cout << "svo: " << octant_steps << " octant steps/ray, " << voxel_steps << " voxel steps/ray, "
+              << rays.size()/svo_time << " rays/s\n";
+    std::cout << "octree: built in " << build_time << "ms, depth " << octree.depth() << ", " << octree.nodeCount()
+              << " nodes, " << octree.leafCount() << " leaves, " << octree.memoryUsage() << " bytes\n";
+    if (mismatches)
+        std::cout << "[!] " << mismatches << " hits differ between dda and svo\n";
+    if (args.verbose)
+        std::cout << "[+] SVO benchmark written to " << output_filename << '\n';
+}
+
+template void benchmarkSvo<SandboxScene>(const SandboxScene&, const ArgParser&);
+template void benchmarkSvo<World>(const World&, const ArgParser&);
+
+template<VoxelScene Scene>
+void benchmarkBrickmap(const Scene& scene, const ArgParser& args) {
+    std::vector<Ray> rays(BENCHMARK_RAY_AMOUNT, Ray(Point(), Point(1., 0., 0.), args.record_trace));
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i)
+        rays[i].reset(BENCHMARK_INITIAL_SEED+i, scene.extent());
+
+    // The brickmap is built beforehand so that only the traversal is measured
+    BrickmapAlgorithm brickmap_algorithm(args.brick_size);
+    const auto t_build_start = std::chrono::high_resolution_clock::now();
+    brickmap_algorithm.build(scene);
+    const auto t_build_end = std::chrono::high_resolution_clock::now();
+    const double build_time = std::chrono::duration<double, std::chrono::milliseconds::period>(t_build_end - t_build_start).count();
+    const Brickmap& brickmap = brickmap_algorithm.getBrickmap();
+
+    DDAAlgorithm dda;
+    std::vector<Hit> dda_hits(rays.size()), brickmap_hits(rays.size());
+    size_t dda_steps, brickmap_steps;
+    const double dda_time = traceCountingSteps(dda, rays, scene, dda_hits, dda_steps);
+    brickmap_algorithm.resetStepCounts();
+    const double brickmap_time = traceCountingSteps(brickmap_algorithm, rays, scene, brickmap_hits, brickmap_steps);
+
+    // Both traversals must hit the same boxes
+    int dda_found = 0, brickmap_found = 0, mismatches = 0;
+    for (size_t i=0; i<rays.size(); ++i) {
+        dda_found += dda_hits[i].found;
+        brickmap_found += brickmap_hits[i].found;
+        mismatches += dda_hits[i].found != brickmap_hits[i].found || !(dda_hits[i].voxel == brickmap_hits[i].voxel)
+                   || dda_hits[i].box != brickmap_hits[i].box;
+    }
+    const double brick_steps = (double)brickmap_algorithm.brickSteps()/rays.size();
+    const double voxel_steps = (double)brickmap_algorithm.voxelSteps()/rays.size();
+
+    const std::string output_filename = args.output_folder+'/'
+        +"brickmap_"+std::filesystem::path(args.chunkPath).stem().string()+'_'+std::to_string(args.brick_size)+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "algorithm;steps_per_ray;brick_steps_per_ray;voxel_steps_per_ray;rays_per_second;hits\n";
+    output << "dda;" << (double)dda_steps/rays.size() << ";0;" << (double)dda_steps/rays.size() << ';'
+           << rays.size()/dda_time << ';' << dda_found << '\n';
+    output << "brickmap;" << (double)brickmap_steps/rays.size() << ';' << brick_steps << ';' << voxel_steps << ';'
+           << rays.size()/brickmap_time << ';' << brickmap_found << '\n';
+    output << "brick_size;build_milliseconds;bricks;occupied_bricks;bytes\n";
+    output << brickmap.brickSide() << ';' << build_time << ';' << brickmap.brickCount() << ';'
+           << brickmap.occupiedBrickCount() << ';' << brickmap.memoryUsage() << '\n';
+
+    std::cout << "dda:      " << (double)dda_steps/rays.size() << " steps/ray, " << rays.size()/dda_time << " rays/s\n";
+    std::cout << "brickmap: " << brick_steps << " brick steps/ray, " << voxel_steps << " voxel steps/ray, "
+              << rays.size()/brickmap_time << " rays/s\n";
+    std::cout << "bricks:   " << brickmap.brickSide() << "^3 voxels, built in " << build_time << "ms, "
+              << brickmap.occupiedBrickCount() << '/' << brickmap.brickCount() << " occupied, "
+              << brickmap.memoryUsage() << " bytes\n";
+    if (mismatches)
+        std::cout << "[!] " << mismatches << " hits differ between dda and brickmap\n";
+    if (args.verbose)
+        std::cout << "[+] Brickmap benchmark written to " << output_filename << '\n';
+}
+
+template void benchmarkBrickmap<SandboxScene>(const SandboxScene&, const ArgParser&);
+template void benchmarkBrickmap<World>(const World&, const ArgParser&);
+
+template<VoxelScene Scene>
+void benchmarkDistance(const Scene& scene, const ArgParser& args) {
+    std::vector<Ray> rays(BENCHMARK_RAY_AMOUNT, Ray(Point(), Point(1., 0., 0.), args.record_trace));
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i)
+        rays[i].reset(BENCHMARK_INITIAL_SEED+i, scene.extent());
+
+    // The field is built beforehand so that only the traversal is measured
+    DistanceMarchingAlgorithm distance_marching;
+    const auto t_build_start = std::chrono::high_resolution_clock::now();
+    distance_marching.build(scene);
+    const auto t_build_end = std::chrono::high_resolution_clock::now();
+    const double build_time = std::chrono::duration<double, std::chrono::milliseconds::period>(t_build_end - t_build_start).count();
+
+    DDAAlgorithm dda;
+    MarchingSlabAlgorithm marching(args.marching_step);
+    std::vector<Hit> dda_hits(rays.size()), marching_hits(rays.size()), distance_hits(rays.size());
+    size_t dda_steps, marching_steps, distance_steps;
+    const double dda_time = traceCountingSteps(dda, rays, scene, dda_hits, dda_steps);
+    const double marching_time = traceCountingSteps(marching, rays, scene, marching_hits, marching_steps);
+    const double distance_time = traceCountingSteps(distance_marching, rays, scene, distance_hits, distance_steps);
+
+    // The distance field marching must hit the same boxes as DDA, the fixed step may miss some
+    int dda_found = 0, marching_found = 0, distance_found = 0, mismatches = 0;
+    for (size_t i=0; i<rays.size(); ++i) {
+        dda_found += dda_hits[i].found;
+        marching_found += marching_hits[i].found;
+        distance_found += distance_hits[i].found;
+        mismatches += dda_hits[i].found != distance_hits[i].found || !(dda_hits[i].voxel == distance_hits[i].voxel)
+                   || dda_hits[i].box != distance_hits[i].box;
+    }
+
+    const std::string output_filename = args.output_folder+'/'
+        +"distance_"+std::filesystem::path(args.chunkPath).stem().string()+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "algorithm;steps_per_ray;rays_per_second;hits\n";
+    output << "dda;" << (double)dda_steps/rays.size() << ';' << rays.size()/dda_time << ';' << dda_found << '\n';
+    output << "slabs_marching_" << args.marching_step << ';' << (double)marching_steps/rays.size() << ';'
+           << rays.size()/marching_time << ';' << marching_found << '\n';
+    output << "distance_marching;" << (double)distance_steps/rays.size() << ';' << rays.size()/distance_time << ';'
+           << distance_found << '\n';
+    output << "build_milliseconds;bytes\n";
+    output << build_time << ';' << distance_marching.getField().memoryUsage() << '\n';
+
+    std::cout << "dda:               " << (double)dda_steps/rays.size() << " steps/ray, " << rays.size()/dda_time
+              << " rays/s, " << dda_found << " hits\n";
+    std::cout << "slabs_marching:    " << (double)marching_steps/rays.size() << " steps/ray, "
+              << rays.size()/marching_time << " rays/s, " << marching_found << " hits (step " << args.marching_step << ")\n";
+    std::cout << "distance_marching: " << (double)distance_steps/rays.size() << " steps/ray, "
+              << rays.size()/distance_time << " rays/s, " << distance_found << " hits\n";
+    std::cout << "field:             built in " << build_time << "ms, " << distance_marching.getField().memoryUsage()
+              << " bytes\n";
+    if (mismatches)
+        std::cout << "[!] " << mismatches << " hits differ between dda and distance_marching\n";
+    if (args.verbose)
+        std::cout << "[+] Distance benchmark written to " << output_filename << '\n';
+}
+
+template void benchmarkDistance<SandboxScene>(const SandboxScene&, const ArgParser&);
+template void benchmarkDistance<World>(const World&, const ArgParser&);
+
+/**
+ * Hardware event counted for the calling thread, see perf_event_open(2).
+ * @note Counters may not be available (virtual machines, perf_event_paranoid), reads then return -1.
+ */
+class PerfCounter {
+private:
+    /**
+     * Descriptor of the counter, -1 if it could not be opened.
+     */
+    int fd;
+
+public:
+    /**
+     * Opens a disabled counter of user space events.
+     * @param   type    Kind of event (PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE...).
+     * @param   config  Event of that kind.
+     */
+    PerfCounter(const uint32_t type, const uint64_t config) : fd(-1) {
+        perf_event_attr attributes;
+        std::memset(&attributes, 0, sizeof(attributes));
+        attributes.size = sizeof(attributes);
+        attributes.type = type;
+        attributes.config = config;
+        attributes.disabled = 1;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        fd = (int)syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+    }
+    PerfCounter(const PerfCounter&) = delete;
+    PerfCounter& operator=(const PerfCounter&) = delete;
+    ~PerfCounter() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    /**
+     * Resets the count and starts counting.
+     */
+    void start() {
+        if (fd < 0)
+            return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+    /**
+     * Stops counting.
+     * @return  Amount of events since start, -1 if the counter is not available.
+     */
+    int64_t stop() {
+        if (fd < 0)
+            return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        int64_t count;
+        return read(fd, &count, sizeof(count)) == sizeof(count) ? count : -1;
+    }
+};
+
+/**
+ * Result of tracing rays on one of the layouts of the Morton benchmark.
+ */
+struct LayoutRun {
+    double rays_per_second;
+    double l1d_misses_per_ray, llc_misses_per_ray;
+    int hits;
+};
+
+/**
+ * Traces the rays BENCHMARK_MORTON_PASSES times and counts the cache misses.
+ * @param   algorithm   Algorithm used to trace the rays.
+ * @param   rays        Rays to trace.
+ * @param   scene       Scene in the layout to measure.
+ * @param   hits        Set to the result of every ray.
+ */
+template<typename Algorithm>
+static LayoutRun traceLayout(Algorithm& algorithm, std::vector<Ray>& rays, const SandboxScene& scene,
+                             std::vector<Hit>& hits) {
+    PerfCounter l1d_misses(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                               | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16));
+    PerfCounter llc_misses(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+    size_t steps;
+    double time = 0.;
+    l1d_misses.start();
+    llc_misses.start();
+    for (int pass=0; pass<BENCHMARK_MORTON_PASSES; ++pass)
+        time += traceCountingSteps(algorithm, rays, scene, hits, steps);
+    const int64_t l1d = l1d_misses.stop(), llc = llc_misses.stop();
+
+    const double traced = (double)rays.size()*BENCHMARK_MORTON_PASSES;
+    int found = 0;
+    for (const Hit& hit : hits)
+        found += hit.found;
+    return {traced/time, l1d < 0 ? -1. : l1d/traced, llc < 0 ? -1. : llc/traced, found};
+}
+
+void benchmarkMorton(const SandboxScene& scene, const ArgParser& args) {
+    std::vector<Ray> rays(BENCHMARK_RAY_AMOUNT, Ray(Point(), Point(1., 0., 0.), args.record_trace));
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i)
+        rays[i].reset(BENCHMARK_INITIAL_SEED+i, scene.extent());
+
+    // The copies share the voxels of the scene until they are stored in another order
+    SandboxScene row_major(scene), morton(scene);
+    row_major.setVoxelLayout(VoxelLayout::ROW_MAJOR);
+    morton.setVoxelLayout(VoxelLayout::MORTON);
+
+    const std::string output_filename = args.output_folder+'/'
+        +"morton_"+std::filesystem::path(args.chunkPath).stem().string()+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "algorithm;layout;rays_per_second;l1d_misses_per_ray;llc_misses_per_ray;hits\n";
+    std::vector<Hit> row_major_hits(rays.size()), morton_hits(rays.size());
+    int mismatches = 0;
+    auto compare = [&](auto& algorithm, const std::string& name) {
+        const LayoutRun runs[2] = {traceLayout(algorithm, rays, row_major, row_major_hits),
+                                   traceLayout(algorithm, rays, morton, morton_hits)};
+        for (size_t i=0; i<rays.size(); ++i)
+            mismatches += row_major_hits[i].found != morton_hits[i].found
+                       || !(row_major_hits[i].voxel == morton_hits[i].voxel) || row_major_hits[i].box != morton_hits[i].box;
+        for (int layout=0; layout<2; ++layout) {
+            const LayoutRun& run = runs[layout];
+            const std::string layout_name = layout ? "morton" : "row_major";
+            output << name << ';' << layout_name << ';' << run.rays_per_second << ';' << run.l1d_misses_per_ray << ';'
+                   << run.llc_misses_per_ray << ';' << run.hits << '\n';
+            std::cout << name << ", " << layout_name << ": " << run.rays_per_second << " rays/s, ";
+            if (run.l1d_misses_per_ray < 0)
+                std::cout << "cache misses not available, ";
+            else
+                std::cout << run.l1d_misses_per_ray << " L1D misses/ray, " << run.llc_misses_per_ray << " LLC misses/ray, ";
+            std::cout << run.hits << " hits\n";
+        }
+    };
+    SlabAlgorithm slabs;
+    DDAAlgorithm dda;
+    compare(slabs, "slabs");
+    compare(dda, "dda");
+
+    if (mismatches)
+        std::cout << "[!] " << mismatches << " hits differ between the layouts\n";
+    if (args.verbose)
+        std::cout << "[+] Morton benchmark written to " << output_filename << " (" << MORTON_INSTRUCTION_SET
+                  << " bit interleaving)\n";
+}
+
+template<VoxelScene Scene>
+void benchmarkSubvoxel(const Scene& scene, const ArgParser& args) {
+    std::vector<Ray> rays(BENCHMARK_RAY_AMOUNT, Ray(Point(), Point(1., 0., 0.), args.record_trace));
+    for (int i=0; i<BENCHMARK_RAY_AMOUNT; ++i)
+        rays[i].reset(BENCHMARK_INITIAL_SEED+i, scene.extent());
+
+    DDAAlgorithm dda;
+    SubvoxelAlgorithm subvoxel;
+    std::vector<Hit> dda_hits(rays.size()), subvoxel_hits(rays.size());
+    size_t dda_steps, subvoxel_steps;
+    const double dda_time = traceCountingSteps(dda, rays, scene, dda_hits, dda_steps);
+    subvoxel.resetStepCounts();
+    const double subvoxel_time = traceCountingSteps(subvoxel, rays, scene, subvoxel_hits, subvoxel_steps);
+
+    // Both traversals visit the same voxels, DDA tests the boxes of every occupied one
+    int dda_found = 0, subvoxel_found = 0, mismatches = 0;
+    for (size_t i=0; i<rays.size(); ++i) {
+        dda_found += dda_hits[i].found;
+        subvoxel_found += subvoxel_hits[i].found;
+        mismatches += dda_hits[i].found != subvoxel_hits[i].found || !(dda_hits[i].voxel == subvoxel_hits[i].voxel)
+                   || dda_hits[i].box != subvoxel_hits[i].box;
+    }
+    const double occupied = (double)subvoxel.occupiedSteps()/rays.size();
+    const double tested = (double)(subvoxel.occupiedSteps() - subvoxel.rejectedSteps())/rays.size();
+
+    const std::string output_filename = args.output_folder+'/'
+        +"subvoxel_"+std::filesystem::path(args.chunkPath).stem().string()+".txt";
+    std::ofstream output(output_filename, std::ios_base::out);
+    output << "algorithm;rays_per_second;occupied_voxels_per_ray;tested_voxels_per_ray;hits\n";
+    output << "dda;" << rays.size()/dda_time << ';' << occupied << ';' << occupied << ';' << dda_found << '\n';
+    output << "subvoxel;" << rays.size()/subvoxel_time << ';' << occupied << ';' << tested << ';' << subvoxel_found << '\n';
+
+    std::cout << "dda:      " << rays.size()/dda_time << " rays/s, " << occupied << " occupied voxels/ray tested\n";
+    std::cout << "subvoxel: " << rays.size()/subvoxel_time << " rays/s, " << tested << " occupied voxels/ray tested, "
+              << occupied - tested << " rejected by their mask\n";
+    if (mismatches)
+        std::cout << "[!] " << mismatches << " hits differ between dda and subvoxel\n";
+    if (args.verbose)
+        std::cout << "[+] Sub-voxel benchmark written to " << output_filename << '\n';
+}
+
+template void benchmarkSubvoxel<SandboxScene>(const SandboxScene&, const ArgParser&);
+template void benchmarkSubvoxel<World>(const World&, const ArgParser&);
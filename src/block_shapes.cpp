@@ -0,0 +1,315 @@
+/**
+ * @file block_shapes.cpp
+ */
+#include "block_shapes.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstring>
+#include <filesystem>
+#include <limits>
+#include <algorithm>
+#include <charconv>
+
+#include "util.hpp"
+
+/**
+ * Header of a block shapes cache file.
+ * @note It is followed by the block names (length then characters) in block number order, the states,
+ *       the shape offsets (uint32_t[shape_count+1]) and the boxes of the shapes.
+ */
+struct BlockShapesCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t block_count;
+    uint64_t content_hash;
+    uint64_t source_size;
+    int64_t source_mtime;
+    uint32_t state_count;
+    uint32_t shape_count;
+    uint32_t box_count;
+    uint32_t padding;
+};
+
+/**
+ * Block state as stored in the cache, followed by the characters of its canonical properties string.
+ */
+struct BlockShapesCacheState {
+    uint32_t block;
+    uint32_t shape;
+    uint32_t properties_length;
+};
+
+/**
+ * Reads a whole file at once.
+ * @param   path    File location.
+ * @param   content Set to the content of the file.
+ * @return  False if the file can't be read.
+ */
+static bool readFile(const std::string& path, std::string& content) {
+    std::ifstream file(path, std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+    if (!file)
+        return false;
+    content.resize(file.tellg());
+    file.seekg(0);
+    file.read(content.data(), content.size());
+    return (bool)file;
+}
+
+uint64_t fnv1a(const char* data, const size_t size) {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    // Whole 64 bits words are mixed at once, the remaining bytes one by one
+    size_t i = 0;
+    for (; i+sizeof(uint64_t)<=size; i+=sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, data+i, sizeof(uint64_t));
+        hash ^= word;
+        hash *= 0x100000001b3ULL;
+    }
+    for (; i<size; ++i) {
+        hash ^= (unsigned char)data[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+void canonicalProperties(const Json::Value& properties, std::string& output) {
+    output.clear();
+    if (!properties.isObject())
+        return;
+    // Members of a JSON object are iterated sorted by name
+    for (auto it = properties.begin(); it != properties.end(); ++it) {
+        if (it != properties.begin())
+            output += ',';
+        const char* begin = nullptr;
+        const char* end = nullptr;
+        begin = it.memberName(&end);
+        output.append(begin, end - begin);
+        output += '=';
+        switch (it->type()) {
+        case Json::stringValue:
+            it->getString(&begin, &end);
+            output.append(begin, end - begin);
+            break;
+        case Json::booleanValue:
+            output += it->asBool() ? "true" : "false";
+            break;
+        case Json::intValue:
+        case Json::uintValue: {
+            char number[24];
+            const std::to_chars_result result = it->isInt64()
+                ? std::to_chars(number, number + sizeof(number), it->asInt64())
+                : std::to_chars(number, number + sizeof(number), it->asUInt64());
+            output.append(number, result.ptr - number);
+            break;
+        }
+        case Json::realValue:
+            output += Json::valueToString(it->asDouble());
+            break;
+        default:
+            // Properties are flat, nested values are left empty
+            break;
+        }
+    }
+}
+
+BlockShapes::BlockShapes(const std::string& shapesPath)
+: blocks(), states(), state_count(0), shapes(std::make_shared<ShapeTable>()), content_hash(0), source_size(0), source_mtime(0),
+  from_cache(false) {
+    // A missing stamp (0) never matches the one of an existing file
+    std::error_code error;
+    const uintmax_t size = std::filesystem::file_size(shapesPath, error);
+    if (!error)
+        source_size = size;
+    const std::filesystem::file_time_type mtime = std::filesystem::last_write_time(shapesPath, error);
+    if (!error)
+        source_mtime = mtime.time_since_epoch().count();
+
+    // The JSON content is only read and hashed when the stamp of the file changed
+    const std::string cachePath = shapesPath + BLOCK_SHAPES_CACHE_SUFFIX;
+    from_cache = loadCache(cachePath, false);
+    if (!from_cache) {
+        std::string content;
+        if (!readFile(shapesPath, content)) {
+            std::cout << "[!] Could not read the block shapes file " << shapesPath << '\n';
+            exit(-1);
+        }
+        content_hash = fnv1a(content.data(), content.size());
+        // An unchanged content only needs the stamp of the cache to be updated
+        from_cache = loadCache(cachePath, true);
+        if (!from_cache)
+            compile(content);
+        if (!saveCache(cachePath))
+            std::cout << "[!] Could not write the block shapes cache " << cachePath << '\n';
+    }
+}
+
+void BlockShapes::compile(const std::string& content) {
+    std::istringstream shapesStream(content);
+    Json::Value shapesData;
+    shapesStream >> shapesData;
+
+    // Shape and properties strings are built into reused buffers
+    std::vector<AABB> shape;
+    std::string properties;
+    blocks.reserve(shapesData.size());
+    states.reserve(shapesData.size());
+    for (auto it = shapesData.begin(); it != shapesData.end(); ++it) {
+        const uint32_t block = (uint32_t)blocks.size();
+        blocks.emplace(it.name(), block);
+        BlockStates& block_states_index = states.emplace_back();
+        const Json::Value& block_states = (*it)["states"];
+        for (unsigned int state_i=0; state_i<block_states.size(); ++state_i) {
+            const char* shape_begin = nullptr;
+            const char* shape_end = nullptr;
+            block_states[state_i]["shape"].getString(&shape_begin, &shape_end);
+            if (!str_to_aabbs(std::string_view(shape_begin, shape_end - shape_begin), shape)) {
+                std::cout << "[!] Invalid shape for the state " << state_i << " of " << it.name() << ": "
+                          << block_states[state_i]["shape"].asString() << '\n';
+                exit(-1);
+            }
+            const ShapeId id = shapes->intern(shape);
+
+            // The first state matching a property set wins, like a linear search would
+            canonicalProperties(block_states[state_i]["properties"], properties);
+            block_states_index.emplace(properties, id);
+            if (state_i == 0)
+                block_states_index.emplace(std::string(), id);
+        }
+        state_count += block_states_index.size();
+    }
+}
+
+bool BlockShapes::loadCache(const std::string& cachePath, const bool checkContent) {
+    std::string data;
+    if (!readFile(cachePath, data))
+        return false;
+
+    // Every read checks that the cache is large enough
+    size_t cursor = 0;
+    auto read = [&data, &cursor](void* dst, const size_t size) {
+        if (cursor + size > data.size())
+            return false;
+        std::memcpy(dst, data.data() + cursor, size);
+        cursor += size;
+        return true;
+    };
+    // Anything read before the cache is found invalid is dropped
+    auto reject = [this]() {
+        blocks.clear();
+        states.clear();
+        state_count = 0;
+        shapes = std::make_shared<ShapeTable>();
+        return false;
+    };
+
+    BlockShapesCacheHeader header;
+    if (!read(&header, sizeof(BlockShapesCacheHeader))
+        || std::memcmp(header.magic, BLOCK_SHAPES_CACHE_MAGIC, sizeof(BLOCK_SHAPES_CACHE_MAGIC))
+        || header.version != BLOCK_SHAPES_CACHE_VERSION)
+        return false;
+    if (checkContent ? header.content_hash != content_hash
+                     : header.source_size != source_size || header.source_mtime != source_mtime || source_mtime == 0)
+        return false;
+    content_hash = header.content_hash;
+    // Shape identifiers are 16 bits and the empty shape always comes first
+    if (header.shape_count == 0 || header.shape_count > (uint32_t)std::numeric_limits<ShapeId>::max()+1)
+        return false;
+
+    blocks.reserve(header.block_count);
+    for (uint32_t block=0; block<header.block_count; ++block) {
+        uint32_t name_length;
+        if (!read(&name_length, sizeof(uint32_t)) || cursor + name_length > data.size()
+            || !blocks.emplace(std::string(data.data() + cursor, name_length), block).second)
+            return reject();
+        cursor += name_length;
+    }
+    // The counts are checked against the size of the file before anything is allocated from them
+    if ((uint64_t)header.state_count*sizeof(BlockShapesCacheState) > data.size() - cursor)
+        return reject();
+    states.resize(header.block_count);
+    for (uint32_t state_i=0; state_i<header.state_count; ++state_i) {
+        BlockShapesCacheState state;
+        if (!read(&state, sizeof(BlockShapesCacheState)) || cursor + state.properties_length > data.size()
+            || state.block >= header.block_count || state.shape >= header.shape_count
+            || !states[state.block].emplace(std::string(data.data() + cursor, state.properties_length),
+                                            (ShapeId)state.shape).second)
+            return reject();
+        cursor += state.properties_length;
+    }
+    state_count = header.state_count;
+    const uint64_t remaining = ((uint64_t)header.shape_count+1)*sizeof(uint32_t) + (uint64_t)header.box_count*sizeof(AABB);
+    if (remaining != data.size() - cursor)
+        return reject();
+    std::vector<uint32_t> offsets(header.shape_count+1);
+    std::vector<AABB> boxes(header.box_count, AABB(Point(), Point()));
+    if (!read(offsets.data(), offsets.size()*sizeof(uint32_t)) || !read(boxes.data(), boxes.size()*sizeof(AABB)))
+        return reject();
+    if (offsets[0] != 0 || offsets[1] != 0 || offsets.back() != header.box_count
+        || !std::is_sorted(offsets.begin(), offsets.end()))
+        return reject();
+
+    // Shapes are interned in file order so that their identifiers are kept, a duplicated shape would shift them
+    for (uint32_t id=1; id<header.shape_count; ++id)
+        if (shapes->intern(std::span<const AABB>(boxes.data() + offsets[id], offsets[id+1] - offsets[id])) != id)
+            return reject();
+    return true;
+}
+
+bool BlockShapes::saveCache(const std::string& cachePath) const {
+    std::ofstream cacheFile(cachePath, std::ios_base::out | std::ios_base::binary);
+    if (!cacheFile)
+        return false;
+
+    BlockShapesCacheHeader header = {};
+    std::memcpy(header.magic, BLOCK_SHAPES_CACHE_MAGIC, sizeof(BLOCK_SHAPES_CACHE_MAGIC));
+    header.version = BLOCK_SHAPES_CACHE_VERSION;
+    header.block_count = (uint32_t)blocks.size();
+    header.content_hash = content_hash;
+    header.source_size = source_size;
+    header.source_mtime = source_mtime;
+    header.state_count = (uint32_t)state_count;
+    header.shape_count = (uint32_t)shapes->size();
+
+    std::vector<std::string_view> names(blocks.size());
+    for (const auto& [name, block] : blocks)
+        names[block] = name;
+    std::vector<uint32_t> offsets(1, 0);
+    std::vector<AABB> boxes;
+    for (size_t id=0; id<shapes->size(); ++id) {
+        const std::span<const AABB> shape = shapes->getShape((ShapeId)id);
+        boxes.insert(boxes.end(), shape.begin(), shape.end());
+        offsets.push_back((uint32_t)boxes.size());
+    }
+    header.box_count = (uint32_t)boxes.size();
+
+    cacheFile.write(reinterpret_cast<const char*>(&header), sizeof(BlockShapesCacheHeader));
+    for (const std::string_view name : names) {
+        const uint32_t name_length = (uint32_t)name.size();
+        cacheFile.write(reinterpret_cast<const char*>(&name_length), sizeof(uint32_t));
+        cacheFile.write(name.data(), name_length);
+    }
+    for (uint32_t block=0; block<states.size(); ++block) {
+        for (const auto& [properties, shape] : states[block]) {
+            const BlockShapesCacheState state = {block, shape, (uint32_t)properties.size()};
+            cacheFile.write(reinterpret_cast<const char*>(&state), sizeof(BlockShapesCacheState));
+            cacheFile.write(properties.data(), properties.size());
+        }
+    }
+    cacheFile.write(reinterpret_cast<const char*>(offsets.data()), offsets.size()*sizeof(uint32_t));
+    cacheFile.write(reinterpret_cast<const char*>(boxes.data()), boxes.size()*sizeof(AABB));
+    return (bool)cacheFile;
+}
+
+bool BlockShapes::findShape(std::string_view name, std::string_view canonical_key, ShapeId& shape) const {
+    const auto block = blocks.find(name);
+    if (block == blocks.end())
+        return false;
+    const BlockStates& block_states = states[block->second];
+    const auto state = block_states.find(canonical_key);
+    if (state == block_states.end())
+        return false;
+    shape = state->second;
+    return true;
+}
@@ -0,0 +1,56 @@
+/**
+ * @file brickmap.cpp
+ */
+#include "brickmap.hpp"
+
+#include <bit>
+
+#include "world.hpp"
+
+
+Brickmap::Brickmap()
+: bricks(1), shift(0), bricks_x(1), bricks_y(1), bricks_z(1) {}
+
+template<VoxelScene Scene>
+Brickmap::Brickmap(const Scene& scene, const int brick_side)
+: bricks(), shift(std::countr_zero((unsigned)brick_side)), bricks_x(0), bricks_y(0), bricks_z(0) {
+    const int size_x = (int)scene.extent().x(), size_y = (int)scene.extent().y(), size_z = (int)scene.extent().z();
+    bricks_x = (size_x + brick_side-1) >> shift;
+    bricks_y = (size_y + brick_side-1) >> shift;
+    bricks_z = (size_z + brick_side-1) >> shift;
+    bricks = OccupancyMask(brickCount());
+
+    for (int by=0; by<bricks_y; ++by) {
+        for (int bz=0; bz<bricks_z; ++bz) {
+            for (int bx=0; bx<bricks_x; ++bx) {
+                const VoxelPosition corner(bx << shift, by << shift, bz << shift);
+                const int max_x = std::min(corner.x + brick_side, size_x) - 1;
+                const int max_y = std::min(corner.y + brick_side, size_y) - 1;
+                const int max_z = std::min(corner.z + brick_side, size_z) - 1;
+
+                // Bricks inside an empty chunk or section are not read
+                VoxelPosition region_min(0, 0, 0), region_max(0, 0, 0);
+                if (scene.findEmptyRegion(corner, region_min, region_max)
+                    && region_max.x >= max_x && region_max.y >= max_y && region_max.z >= max_z)
+                    continue;
+
+                bool occupied = false;
+                for (int y=corner.y; y<=max_y && !occupied; ++y)
+                    for (int z=corner.z; z<=max_z && !occupied; ++z)
+                        for (int x=corner.x; x<=max_x && !occupied; ++x)
+                            occupied = scene.isOccupied(VoxelPosition(x, y, z));
+                bricks.set(brickIndex(bx, by, bz), occupied);
+            }
+        }
+    }
+}
+
+size_t Brickmap::occupiedBrickCount() const {
+    size_t count = 0;
+    for (size_t w=0; w<bricks.wordCount(); ++w)
+        count += std::popcount(bricks.raw()[w]);
+    return count;
+}
+
+template Brickmap::Brickmap<SandboxScene>(const SandboxScene&, const int);
+template Brickmap::Brickmap<World>(const World&, const int);
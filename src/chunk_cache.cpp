@@ -0,0 +1,190 @@
+/**
+ * @file chunk_cache.cpp
+ */
+#include "chunk_cache.hpp"
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <json/json.h>
+
+
+ChunkCache::ChunkCache(std::vector<std::filesystem::path> files, const std::unordered_map<size_t, ChunkSource>& sources,
+                       const BlockShapes& block_shapes, const int chunks_x, const int chunks_z, const size_t budget,
+                       const bool lazy_sections, const VoxelLayout voxel_layout)
+: files(std::move(files)), regions(), block_shapes(block_shapes), chunks_x(chunks_x), chunks_z(chunks_z),
+  budget(budget), voxel_layout(voxel_layout), slots(), lru(), last_slot(SIZE_MAX), decoder(lazy_sections),
+  stats({0, 0, 0, 0, 0, 0, 0, 0}), in_flight(), prefetching(SIZE_MAX), ready(), prefetch_decoder(lazy_sections),
+  prefetcher(1) {
+    regions.resize(this->files.size());
+    for (size_t f=0; f<this->files.size(); ++f)
+        if (isRegionFile(this->files[f]))
+            regions[f] = std::make_unique<RegionFile>(this->files[f]);
+    slots.reserve(sources.size());
+    for (const auto& [slot, source] : sources)
+        slots.emplace(slot, CachedChunk{source, nullptr, 0, lru.end(), false});
+}
+
+std::unique_ptr<SandboxScene> ChunkCache::load(const ChunkSource& source, ChunkDecoder& chunk_decoder) const {
+    if (source.chunk < 0) {
+        // Parsed without exceptions, the prefetching worker can not let one escape
+        Json::Value chunkData;
+        if (!readChunkFile(files[source.file], block_shapes, chunkData))
+            return nullptr;
+        auto chunk = std::make_unique<SandboxScene>(chunkData, block_shapes);
+        chunk->setVoxelLayout(voxel_layout);
+        return chunk;
+    }
+    ChunkPosition position = {0, 0};
+    auto chunk = std::make_unique<SandboxScene>(0, 0, 0, block_shapes.getShapeTable());
+    if (!chunk_decoder.readChunk(*regions[source.file], source.chunk, block_shapes, position, *chunk))
+        return nullptr;
+    chunk->setVoxelLayout(voxel_layout);
+    return chunk;
+}
+
+void ChunkCache::insert(const size_t slot, CachedChunk& cached, std::unique_ptr<SandboxScene> chunk) {
+    cached.bytes = chunkBytes(*chunk);
+    cached.chunk = std::move(chunk);
+    lru.push_front(slot);
+    cached.lru_position = lru.begin();
+    ++stats.resident_chunks;
+    stats.resident_bytes += cached.bytes;
+}
+
+void ChunkCache::evict() {
+    // The most recently used chunk is the one being entered, it is never evicted
+    while (stats.resident_bytes > budget && lru.size() > 1) {
+        CachedChunk& victim = slots.find(lru.back())->second;
+        lru.pop_back();
+        victim.chunk.reset();
+        victim.prefetched = false;
+        stats.resident_bytes -= victim.bytes;
+        --stats.resident_chunks;
+        ++stats.evictions;
+    }
+}
+
+void ChunkCache::collectPrefetched() {
+    std::unordered_map<size_t, std::unique_ptr<SandboxScene>> chunks;
+    {
+        std::lock_guard<std::mutex> lock(prefetch_mutex);
+        if (ready.empty())
+            return;
+        chunks.swap(ready);
+    }
+    // Inserted before the chunk being entered, so they are evicted first if the budget is tight
+    for (auto& [slot, chunk] : chunks) {
+        CachedChunk& cached = slots.find(slot)->second;
+        if (!chunk || cached.chunk)
+            continue;
+        insert(slot, cached, std::move(chunk));
+        cached.prefetched = true;
+    }
+}
+
+void ChunkCache::prefetchAhead(const size_t slot, const int dx, const int dz) {
+    int x = (int)(slot % chunks_x), z = (int)(slot / chunks_x);
+    for (int d=0; d<CHUNK_CACHE_PREFETCH_DISTANCE; ++d) {
+        x += dx;
+        z += dz;
+        if (x < 0 || z < 0 || x >= chunks_x || z >= chunks_z)
+            return;
+        const size_t next = (size_t)z*chunks_x + x;
+        const auto cached = slots.find(next);
+        if (cached == slots.end() || cached->second.chunk)
+            continue;
+        {
+            std::lock_guard<std::mutex> lock(prefetch_mutex);
+            if (in_flight.size() >= CHUNK_CACHE_PREFETCH_QUEUE)
+                return;
+            if (ready.count(next) || !in_flight.insert(next).second)
+                continue;
+        }
+        ++stats.prefetches;
+        prefetcher.submit([this, next, &source = cached->second.source](const int) {
+            {
+                std::lock_guard<std::mutex> lock(prefetch_mutex);
+                if (!in_flight.count(next))
+                    return;
+                prefetching = next;
+            }
+            std::unique_ptr<SandboxScene> chunk = load(source, prefetch_decoder);
+            {
+                std::lock_guard<std::mutex> lock(prefetch_mutex);
+                ready[next] = std::move(chunk);
+                in_flight.erase(next);
+                prefetching = SIZE_MAX;
+            }
+            prefetch_done.notify_all();
+        });
+    }
+}
+
+const SandboxScene* ChunkCache::fetch(const size_t slot) {
+    // Lazy sections expanded since the last chunk was entered make it bigger
+    if (last_slot != SIZE_MAX) {
+        const auto last = slots.find(last_slot);
+        if (last != slots.end() && last->second.chunk) {
+            const size_t last_bytes = chunkBytes(*last->second.chunk);
+            stats.resident_bytes += last_bytes - last->second.bytes;
+            last->second.bytes = last_bytes;
+        }
+    }
+    const size_t previous_slot = last_slot;
+    last_slot = slot;
+    const auto entry = slots.find(slot);
+    if (entry == slots.end())
+        return nullptr;
+    CachedChunk& cached = entry->second;
+
+    // Nothing is evicted until the chunk entered is the most recently used one, so that it is never the one evicted
+    collectPrefetched();
+    if (cached.chunk) {
+        ++stats.hits;
+        stats.prefetch_hits += cached.prefetched;
+        cached.prefetched = false;
+        lru.splice(lru.begin(), lru, cached.lru_position);
+    } else {
+        ++stats.misses;
+        const auto t_start = std::chrono::steady_clock::now();
+        std::unique_ptr<SandboxScene> chunk;
+        {
+            // A chunk being prefetched is waited for rather than decoded twice, a queued one is decoded now
+            std::unique_lock<std::mutex> lock(prefetch_mutex);
+            if (prefetching != slot)
+                in_flight.erase(slot);
+            prefetch_done.wait(lock, [this, slot] { return !in_flight.count(slot); });
+            const auto it = ready.find(slot);
+            if (it != ready.end()) {
+                chunk = std::move(it->second);
+                ready.erase(it);
+            }
+        }
+        if (!chunk)
+            chunk = load(cached.source, decoder);
+        const auto t_end = std::chrono::steady_clock::now();
+        stats.miss_nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count();
+        if (!chunk) {
+            std::cout << "[!] Could not read the chunk of slot " << slot << " again from " << files[cached.source.file]
+                      << '\n';
+            exit(-1);
+        }
+        insert(slot, cached, std::move(chunk));
+    }
+    evict();
+
+    // Rays crossing into a neighbouring chunk are likely to keep going the same way
+    if (previous_slot != SIZE_MAX) {
+        const int dx = (int)(slot % chunks_x) - (int)(previous_slot % chunks_x);
+        const int dz = (int)(slot / chunks_x) - (int)(previous_slot / chunks_x);
+        if (std::abs(dx) <= 1 && std::abs(dz) <= 1 && (dx || dz))
+            prefetchAhead(slot, dx, dz);
+    }
+    return cached.chunk.get();
+}
+
+size_t ChunkCache::chunkCount() const {
+    return slots.size();
+}
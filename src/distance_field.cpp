@@ -0,0 +1,105 @@
+/**
+ * @file distance_field.cpp
+ */
+#include "distance_field.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+
+#include "world.hpp"
+
+
+DistanceField::DistanceField()
+: distances(1, 1, 1, DISTANCE_FIELD_MAX) {}
+
+template<VoxelScene Scene>
+DistanceField::DistanceField(const Scene& scene)
+: distances((int)scene.extent().x(), (int)scene.extent().y(), (int)scene.extent().z(), DISTANCE_FIELD_MAX) {
+    const int size_x = distances.sizeX(), size_y = distances.sizeY(), size_z = distances.sizeZ();
+
+    // Occupied voxels are the seeds, blocks inside empty sections or chunks are skipped
+    for (int by=0; by<size_y; by+=SECTION_SIDE_SIZE) {
+        for (int bz=0; bz<size_z; bz+=SECTION_SIDE_SIZE) {
+            for (int bx=0; bx<size_x; bx+=SECTION_SIDE_SIZE) {
+                const int max_x = std::min(bx + SECTION_SIDE_SIZE, size_x) - 1;
+                const int max_y = std::min(by + SECTION_SIDE_SIZE, size_y) - 1;
+                const int max_z = std::min(bz + SECTION_SIDE_SIZE, size_z) - 1;
+                VoxelPosition region_min(0, 0, 0), region_max(0, 0, 0);
+                if (scene.findEmptyRegion(VoxelPosition(bx, by, bz), region_min, region_max)
+                    && region_max.x >= max_x && region_max.y >= max_y && region_max.z >= max_z)
+                    continue;
+                for (int y=by; y<=max_y; ++y)
+                    for (int z=bz; z<=max_z; ++z)
+                        for (int x=bx; x<=max_x; ++x)
+                            if (scene.isOccupied(VoxelPosition(x, y, z)))
+                                distances.at(x, y, z) = 0;
+            }
+        }
+    }
+
+    // Each pass propagates the distances from the 13 neighbours already visited, in storage order then backwards
+    std::array<std::ptrdiff_t, 13> offsets;
+    int count = 0;
+    for (int dy=-1; dy<=1; ++dy)
+        for (int dz=-1; dz<=1; ++dz)
+            for (int dx=-1; dx<=1; ++dx)
+                if ((dy != 0 ? dy : (dz != 0 ? dz : dx)) == -1)
+                    offsets[count++] = ((std::ptrdiff_t)dy*size_z + dz)*size_x + dx;
+
+    // Voxels on the faces of the scene check the bounds of each neighbour
+    auto relax = [&](const int x, const int y, const int z, const int direction) {
+        uint8_t& d = distances.at(x, y, z);
+        if (d == 0)
+            return;
+        int best = d;
+        for (int dy=-1; dy<=1; ++dy) {
+            for (int dz=-1; dz<=1; ++dz) {
+                for (int dx=-1; dx<=1; ++dx) {
+                    if ((dy != 0 ? dy : (dz != 0 ? dz : dx)) != -direction)
+                        continue;
+                    const int nx = x+dx, ny = y+dy, nz = z+dz;
+                    if (nx < 0 || ny < 0 || nz < 0 || nx >= size_x || ny >= size_y || nz >= size_z)
+                        continue;
+                    best = std::min(best, distances.at(nx, ny, nz) + 1);
+                }
+            }
+        }
+        d = (uint8_t)std::min(best, DISTANCE_FIELD_MAX);
+    };
+    // Inner voxels read their neighbours at fixed offsets in the storage
+    auto relaxInner = [&](uint8_t* d, const int direction) {
+        if (*d == 0)
+            return;
+        int best = *d;
+        for (const std::ptrdiff_t offset : offsets)
+            best = std::min(best, d[direction*offset] + 1);
+        *d = (uint8_t)std::min(best, DISTANCE_FIELD_MAX);
+    };
+    auto relaxRow = [&](const int y, const int z, const int direction) {
+        const bool inner = y > 0 && z > 0 && y < size_y-1 && z < size_z-1 && size_x > 2;
+        if (!inner) {
+            for (int i=0; i<size_x; ++i)
+                relax(direction > 0 ? i : size_x-1-i, y, z, direction);
+            return;
+        }
+        uint8_t* row = distances.raw() + distances.index(0, y, z);
+        relax(direction > 0 ? 0 : size_x-1, y, z, direction);
+        if (direction > 0)
+            for (int x=1; x<size_x-1; ++x)
+                relaxInner(row + x, direction);
+        else
+            for (int x=size_x-2; x>0; --x)
+                relaxInner(row + x, direction);
+        relax(direction > 0 ? size_x-1 : 0, y, z, direction);
+    };
+    for (int y=0; y<size_y; ++y)
+        for (int z=0; z<size_z; ++z)
+            relaxRow(y, z, 1);
+    for (int y=size_y-1; y>=0; --y)
+        for (int z=size_z-1; z>=0; --z)
+            relaxRow(y, z, -1);
+}
+
+template DistanceField::DistanceField<SandboxScene>(const SandboxScene&);
+template DistanceField::DistanceField<World>(const World&);
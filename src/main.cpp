@@ -11,19 +11,87 @@
 
 #include "argparser.hpp"
 #include "scene.hpp"
+#include "scene_file.hpp"
+#include "world.hpp"
+#include "region.hpp"
 #include "ray.hpp"
 #include "ray_algorithm.hpp"
 #include "util.hpp"
+#include "benchmark.hpp"
 
 // == GLOBALS
 bool raystep_pressed = false;
 bool rayreset_pressed = false;
 
+std::unique_ptr<const BlockShapes> block_shapes;// outlives world, whose chunk cache reads chunks again
 std::unique_ptr<SandboxScene> scene;
+std::unique_ptr<World> world;// set instead of scene when a folder of chunks is loaded
 std::unique_ptr<Ray> ray;
 std::unique_ptr<RayAlgorithm> ray_algorithm;// defaults to SlabAlgorithm
 
 // == FUNCTIONS
+/**
+ * Builds the concrete algorithm selected in the arguments and calls f with it.
+ * @note f is instantiated once per algorithm type, so everything it calls is statically dispatched.
+ * @param   args    Program arguments.
+ * @param   f       Generic callable taking the algorithm by reference.
+ */
+template<typename F>
+void withStaticAlgorithm(const ArgParser& args, F&& f) {
+    switch (args.ray_algorithm) {
+    case RayAlgorithms::SLABS: {
+        SlabAlgorithm algorithm;
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::SLABS_MARCHING: {
+        MarchingSlabAlgorithm algorithm(args.marching_step);
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::BITMASK: {
+        BitmaskAlgorithm algorithm;
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::BITMASK_MARCHING: {
+        MarchingBitmaskAlgorithm algorithm(args.marching_step);
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::DDA: {
+        DDAAlgorithm algorithm;
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::SLABS_SIMD: {
+        SimdSlabAlgorithm algorithm;
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::SVO: {
+        SvoAlgorithm algorithm;
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::BRICKMAP: {
+        BrickmapAlgorithm algorithm(args.brick_size);
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::DISTANCE_MARCHING: {
+        DistanceMarchingAlgorithm algorithm;
+        f(algorithm);
+        break;
+    }
+    case RayAlgorithms::SUBVOXEL: {
+        SubvoxelAlgorithm algorithm;
+        f(algorithm);
+        break;
+    }
+    }
+}
+
 /**
  * Function called at the begining of the main code to initialize needed things.
  */
@@ -60,7 +128,7 @@ void uiCallback() {
         raystep_pressed = false;
     }
     if (rayreset_pressed) {
-        ray->reset();
+        ray->reset(0, scene->extent());
         draw();
         rayreset_pressed = false;
     }
@@ -70,14 +138,68 @@ void uiCallback() {
 int main(const int argc, const char** argv) {
     ArgParser args(argc, argv);
 
-    // Load the JSON file into a scene
+    // Load the chunk file into a scene
     if (args.verbose)
         std::cout << "[+] Parsing the chunk file into a scene\n";
     //SandboxScene scene(10,10,10);
-    scene = std::make_unique<SandboxScene>(args.chunkPath, args.shapesPath, args.section);
+    const auto t_load_start = std::chrono::high_resolution_clock::now();
+    if (isSceneFile(args.chunkPath))
+        scene = std::make_unique<SandboxScene>(args.chunkPath);
+    else {
+        block_shapes = std::make_unique<const BlockShapes>(args.shapesPath);
+        if (args.verbose)
+            std::cout << "[+] " << block_shapes->stateCount() << " block states "
+                      << (block_shapes->isFromCache() ? "read from the cache" : "compiled from the JSON file") << '\n';
+        if (std::filesystem::is_directory(args.chunkPath) || isRegionFile(args.chunkPath)) {
+            ThreadPool pool(args.thread_count);
+            world = std::make_unique<World>(args.chunkPath, *block_shapes, pool, args.lazy_sections, args.cache_budget,
+                                            args.dedup_sections,
+                                            args.morton_layout ? VoxelLayout::MORTON : VoxelLayout::ROW_MAJOR);
+        } else if (args.full_chunk) {
+            scene = std::make_unique<SandboxScene>(args.chunkPath, *block_shapes);
+        } else {
+            scene = std::make_unique<SandboxScene>(args.chunkPath, *block_shapes, args.section);
+        }
+    }
+    // Sections are reordered before being deduplicated, reordering copies the voxels shared between sections
+    if (scene && args.morton_layout)
+        scene->setVoxelLayout(VoxelLayout::MORTON);
+    DedupStats dedup_stats = world ? world->dedupStats() : DedupStats{0, 0, 0};
+    if (scene && args.dedup_sections) {
+        SectionInterner interner;
+        scene->internSections(interner);
+        dedup_stats = interner.getStats();
+    }
+    const auto t_load_end = std::chrono::high_resolution_clock::now();
+    if (args.verbose && world)
+        std::cout << "[+] World loaded in "
+                  << std::chrono::duration<double, std::chrono::milliseconds::period>(t_load_end - t_load_start).count()
+                  << "ms: " << world->chunkCount() << " chunks (" << world->emptyChunkCount() << " empty skipped), "
+                  << world->getShapes().size() << " distinct shapes, " << world->packedSectionCount()
+                  << " packed sections, " << world->memoryUsage() << " bytes\n";
+    else if (args.verbose)
+        std::cout << "[+] Scene loaded in "
+                  << std::chrono::duration<double, std::chrono::milliseconds::period>(t_load_end - t_load_start).count()
+                  << "ms: " << scene->getShapes().size() << " distinct shapes, "
+                  << scene->memoryUsage() << " bytes\n";
+    if (args.verbose && args.dedup_sections)
+        std::cout << "[+] " << dedup_stats.dense_sections << " dense sections deduplicated into "
+                  << dedup_stats.distinct_sections << " distinct ones, " << dedup_stats.saved_bytes << " bytes saved\n";
+
+    if (args.convert_path != "") {
+        if (world) {
+            std::cout << "Only single chunks can be converted to a scene file\n";
+            exit(-1);
+        }
+        scene->save(args.convert_path);
+        std::cout << "[+] Scene written to " << args.convert_path << '\n';
+        return 0;
+    }
 
     // Create a Ray
-    ray = std::make_unique<Ray>(Point(8.,5.5,4.5), Point(1.,0.,0.));
+    // The GUI draws the whole trace, benchmarks only record it when asked to
+    const bool gui = !args.benchmark && args.bench_mode == BenchModes::BENCH_NONE;
+    ray = std::make_unique<Ray>(Point(8.,5.5,4.5), Point(1.,0.,0.), gui || args.record_trace);
 
     // Create a Ray Shooting Algorithm
     switch (args.ray_algorithm) {
@@ -93,12 +215,113 @@ int main(const int argc, const char** argv) {
     case RayAlgorithms::BITMASK_MARCHING:
         ray_algorithm = std::make_unique<MarchingBitmaskAlgorithm>(args.marching_step);
         break;
+    case RayAlgorithms::DDA:
+        ray_algorithm = std::make_unique<DDAAlgorithm>();
+        break;
+    case RayAlgorithms::SLABS_SIMD:
+        ray_algorithm = std::make_unique<SimdSlabAlgorithm>();
+        break;
+    case RayAlgorithms::SVO:
+        ray_algorithm = std::make_unique<SvoAlgorithm>();
+        break;
+    case RayAlgorithms::BRICKMAP:
+        ray_algorithm = std::make_unique<BrickmapAlgorithm>(args.brick_size);
+        break;
+    case RayAlgorithms::DISTANCE_MARCHING:
+        ray_algorithm = std::make_unique<DistanceMarchingAlgorithm>();
+        break;
+    case RayAlgorithms::SUBVOXEL:
+        ray_algorithm = std::make_unique<SubvoxelAlgorithm>();
+        break;
     }
+    // Acceleration structures are built before the first ray is traced, the benchmarks prepare their own algorithms
+    if (!world && args.bench_mode == BenchModes::BENCH_NONE)
+        ray_algorithm->prepare(*scene);
 
-    if (args.benchmark) {
+    if (world) {
+        // Worlds are only traced by the benchmarks
+        switch (args.bench_mode) {
+        case BenchModes::BENCH_TRACE:
+            benchmarkTrace(*world, *ray_algorithm, args);
+            break;
+        case BenchModes::BENCH_DISPATCH:
+            withStaticAlgorithm(args, [&args](auto& algorithm) {
+                benchmarkDispatch(*world, algorithm, args);
+            });
+            break;
+        case BenchModes::BENCH_LOAD:
+            benchmarkLoad(args);
+            break;
+        case BenchModes::BENCH_LAZY:
+            withStaticAlgorithm(args, [&args](auto& algorithm) {
+                benchmarkLazy(*world, algorithm, args);
+            });
+            break;
+        case BenchModes::BENCH_CACHE:
+            withStaticAlgorithm(args, [&args](auto& algorithm) {
+                benchmarkCache(*world, algorithm, args);
+            });
+            break;
+        case BenchModes::BENCH_SVO:
+            benchmarkSvo(*world, args);
+            break;
+        case BenchModes::BENCH_BRICKMAP:
+            benchmarkBrickmap(*world, args);
+            break;
+        case BenchModes::BENCH_DISTANCE:
+            benchmarkDistance(*world, args);
+            break;
+        case BenchModes::BENCH_SUBVOXEL:
+            benchmarkSubvoxel(*world, args);
+            break;
+        default:
+            std::cout << "Only the trace, dispatch, load, lazy, cache, svo, brickmap, distance and subvoxel benchmarks can "
+                         "run on a folder of chunks\n";
+            exit(-1);
+        }
+    } else if (args.bench_mode != BenchModes::BENCH_NONE) {
+        if (args.verbose)
+            std::cout << "[+] Running the " << args.bench_mode << " benchmark\n";
+        switch (args.bench_mode) {
+        case BenchModes::BENCH_LAYOUT:
+            benchmarkLayout(*scene, args);
+            break;
+        case BenchModes::BENCH_TRACE:
+            benchmarkTrace(*scene, *ray_algorithm, args);
+            break;
+        case BenchModes::BENCH_DISPATCH:
+            withStaticAlgorithm(args, [&args](auto& algorithm) {
+                benchmarkDispatch(*scene, algorithm, args);
+            });
+            break;
+        case BenchModes::BENCH_PACKET:
+            benchmarkPacket(*scene, args);
+            break;
+        case BenchModes::BENCH_PARSER:
+            benchmarkParser(args);
+            break;
+        case BenchModes::BENCH_SVO:
+            benchmarkSvo(*scene, args);
+            break;
+        case BenchModes::BENCH_BRICKMAP:
+            benchmarkBrickmap(*scene, args);
+            break;
+        case BenchModes::BENCH_DISTANCE:
+            benchmarkDistance(*scene, args);
+            break;
+        case BenchModes::BENCH_MORTON:
+            benchmarkMorton(*scene, args);
+            break;
+        case BenchModes::BENCH_SUBVOXEL:
+            benchmarkSubvoxel(*scene, args);
+            break;
+        default:
+            break;
+        }
+    } else if (args.benchmark) {
         // Shoot N rays and measure the execution time.
-        constexpr int N = 10000;
-        constexpr int initial_seed = 1;
+        constexpr int N = BENCHMARK_RAY_AMOUNT;
+        constexpr int initial_seed = BENCHMARK_INITIAL_SEED;
         const std::string output_filename = args.output_folder+'/'
             +"benchmark_"+std::filesystem::path(args.chunkPath).stem().string()+'_'
             +std::to_string(N)+'_'+convert_to_string(args.ray_algorithm)
@@ -113,7 +336,7 @@ int main(const int argc, const char** argv) {
         // Shoot N rays
         for (int i=0; i<N; ++i) {
             // Shoot a ray until it intersects or goes out of the scene
-            ray->reset(initial_seed+i);
+            ray->reset(initial_seed+i, scene->extent());
             Point ray_pos = ray->getOrigin();
             output << ray_pos << ';' << ray->getDirection() << '|';
 
@@ -140,7 +363,7 @@ int main(const int argc, const char** argv) {
         polyscope::options::automaticallyComputeSceneExtents = false;
         polyscope::state::lengthScale = 5.;
         polyscope::state::boundingBox = std::tuple<glm::vec3, glm::vec3>{
-            {0., 0., 0.}, {CHUNK_SIDE_SIZE, CHUNK_SIDE_SIZE, CHUNK_SIDE_SIZE}
+            {0., 0., 0.}, {(float)scene->sizeX(), (float)scene->sizeY(), (float)scene->sizeZ()}
         };
 
         // Build the Mesh
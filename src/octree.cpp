@@ -0,0 +1,84 @@
+/**
+ * @file octree.cpp
+ */
+#include "octree.hpp"
+
+#include "world.hpp"
+
+
+SparseVoxelOctree::SparseVoxelOctree()
+: nodes(1, SvoNode{0, 0, 0, 0}), leaves(), root(0), levels(1), size_x(1), size_y(1), size_z(1) {}
+
+template<VoxelScene Scene>
+SparseVoxelOctree::SparseVoxelOctree(const Scene& scene)
+: nodes(), leaves(), root(0), levels(1), size_x((int)scene.extent().x()), size_y((int)scene.extent().y()),
+  size_z((int)scene.extent().z()) {
+    while ((1 << levels) < std::max({size_x, size_y, size_z}))
+        ++levels;
+    SvoNode root_node = {0, 0, 0, 0};
+    ShapeId shape = EMPTY_SHAPE;
+    if (buildNode(scene, levels, VoxelPosition(0, 0, 0), root_node, shape) == Octant::UNIFORM) {
+        // The root is always a node, a uniform scene is split in 8 leaves
+        root_node = {0, (uint32_t)leaves.size(), 0, 0xff};
+        leaves.insert(leaves.end(), 8, shape);
+    }
+    root = (uint32_t)nodes.size();
+    nodes.push_back(root_node);
+    nodes.shrink_to_fit();
+    leaves.shrink_to_fit();
+}
+
+template<VoxelScene Scene>
+SparseVoxelOctree::Octant SparseVoxelOctree::buildNode(const Scene& scene, const int level, const VoxelPosition& corner,
+                                                       SvoNode& node, ShapeId& shape) {
+    if (corner.x >= size_x || corner.y >= size_y || corner.z >= size_z)
+        return Octant::EMPTY;
+    if (level == 0) {
+        if (!scene.isOccupied(corner))
+            return Octant::EMPTY;
+        shape = scene.getShapeId(corner);
+        return Octant::UNIFORM;
+    }
+
+    // Cubes inside an empty chunk or section are skipped as a whole
+    const int side = 1 << level;
+    VoxelPosition region_min(0, 0, 0), region_max(0, 0, 0);
+    if (scene.findEmptyRegion(corner, region_min, region_max)
+        && region_min.x <= corner.x && region_min.y <= corner.y && region_min.z <= corner.z
+        && region_max.x >= std::min(corner.x + side, size_x) - 1 && region_max.y >= std::min(corner.y + side, size_y) - 1
+        && region_max.z >= std::min(corner.z + side, size_z) - 1)
+        return Octant::EMPTY;
+
+    const int half = side / 2;
+    SvoNode children[8];
+    ShapeId shapes[8];
+    Octant kinds[8];
+    bool uniform = true;
+    for (int octant=0; octant<8; ++octant) {
+        const VoxelPosition child_corner(corner.x + (octant & 1)*half, corner.y + ((octant >> 1) & 1)*half,
+                                         corner.z + ((octant >> 2) & 1)*half);
+        kinds[octant] = buildNode(scene, level-1, child_corner, children[octant], shapes[octant]);
+        uniform = uniform && kinds[octant] == Octant::UNIFORM && shapes[octant] == shapes[0];
+    }
+    // Octants sharing a single shape are merged into a leaf of the parent
+    if (uniform) {
+        shape = shapes[0];
+        return Octant::UNIFORM;
+    }
+
+    // Children are appended together once all of them are built, their own children being stored before them
+    node = {(uint32_t)nodes.size(), (uint32_t)leaves.size(), 0, 0};
+    for (int octant=0; octant<8; ++octant) {
+        if (kinds[octant] == Octant::MIXED) {
+            node.child_mask |= 1 << octant;
+            nodes.push_back(children[octant]);
+        } else if (kinds[octant] == Octant::UNIFORM) {
+            node.leaf_mask |= 1 << octant;
+            leaves.push_back(shapes[octant]);
+        }
+    }
+    return (node.child_mask | node.leaf_mask) ? Octant::MIXED : Octant::EMPTY;
+}
+
+template SparseVoxelOctree::SparseVoxelOctree<SandboxScene>(const SandboxScene&);
+template SparseVoxelOctree::SparseVoxelOctree<World>(const World&);
@@ -0,0 +1,134 @@
+/**
+ * @file packet.cpp
+ */
+#include "packet.hpp"
+
+#include <bit>
+#include <cmath>
+
+#include "simd.hpp"
+
+template<int Width>
+void PacketTracer<Width>::initialize(std::span<const Ray, Width> rays) {
+    for (int lane=0; lane<Width; ++lane) {
+        const Point o = rays[lane].getOrigin();
+        const Point d = rays[lane].getDirection();
+        for (int axis=0; axis<3; ++axis) {
+            origin[axis][lane] = o[axis];
+            direction[axis][lane] = d[axis];
+            inv_direction[axis][lane] = 1. / d[axis];
+            cell[axis][lane] = (int)std::floor(o[axis]);
+            if (d[axis] > 0) {
+                cell_step[axis][lane] = 1;
+                t_delta[axis][lane] = 1. / d[axis];
+                t_max[axis][lane] = (cell[axis][lane] + 1 - o[axis]) * t_delta[axis][lane];
+            } else if (d[axis] < 0) {
+                cell_step[axis][lane] = -1;
+                t_delta[axis][lane] = -1. / d[axis];
+                t_max[axis][lane] = (o[axis] - cell[axis][lane]) * t_delta[axis][lane];
+            } else {
+                cell_step[axis][lane] = 0;
+                t_delta[axis][lane] = HUGE_VAL;
+                t_max[axis][lane] = HUGE_VAL;
+            }
+        }
+    }
+}
+
+template<int Width>
+void PacketTracer<Width>::tracePacket(std::span<const Ray, Width> rays, const SandboxScene& scene, std::span<Hit, Width> hits) {
+    initialize(rays);
+    for (Hit& hit : hits)
+        hit = Hit();
+
+    alignas(CACHE_LINE_SIZE) double origin_relative[3][Width];
+    alignas(CACHE_LINE_SIZE) double distance[Width];
+    double nearest_distance[Width];
+    int nearest_box[Width];
+
+    unsigned int active = (1u << Width) - 1;
+    while (active) {
+        // Lanes leaving the scene are done, the others are sorted out by occupancy
+        unsigned int pending = 0;
+        for (int lane=0; lane<Width; ++lane) {
+            if (!((active >> lane) & 1))
+                continue;
+            const VoxelPosition tile(cell[0][lane], cell[1][lane], cell[2][lane]);
+            if (!scene.inBounds(tile))
+                active &= ~(1u << lane);
+            else if (scene.isOccupied(tile))
+                pending |= 1u << lane;
+        }
+
+        // Lanes standing in the same voxel are tested together with a single fetch of its boxes
+        while (pending) {
+            const int first = std::countr_zero(pending);
+            const VoxelPosition tile(cell[0][first], cell[1][first], cell[2][first]);
+            unsigned int group = 0;
+            for (int lane=first; lane<Width; ++lane) {
+                if ((pending >> lane) & 1 && cell[0][lane] == tile.x && cell[1][lane] == tile.y && cell[2][lane] == tile.z)
+                    group |= 1u << lane;
+            }
+            pending &= ~group;
+
+            for (int axis=0; axis<3; ++axis) {
+                const double corner = (double)(axis == 0 ? tile.x : axis == 1 ? tile.y : tile.z);
+                for (int lane=0; lane<Width; ++lane)
+                    origin_relative[axis][lane] = origin[axis][lane] - corner;
+            }
+            for (int lane=0; lane<Width; ++lane) {
+                nearest_distance[lane] = HUGE_VAL;
+                nearest_box[lane] = -1;
+            }
+
+            const std::span<const AABB> boxes = scene.getVoxel(tile).getContents();
+            ++fetches;
+            for (size_t i=0; i<boxes.size(); ++i) {
+                for (int half=0; half<Width; half+=4) {
+                    const int lanes = (group >> half) & 0xF;
+                    if (!lanes)
+                        continue;
+                    const int hit_mask = simdSlabsPacket(&origin_relative[0][half], &direction[0][half],
+                                                         &inv_direction[0][half], Width, boxes[i], lanes, distance);
+                    for (int lane=0; lane<4; ++lane) {
+                        if ((hit_mask >> lane) & 1 && distance[lane] < nearest_distance[half+lane]) {
+                            nearest_distance[half+lane] = distance[lane];
+                            nearest_box[half+lane] = (int)i;
+                        }
+                    }
+                }
+            }
+
+            for (int lane=first; lane<Width; ++lane) {
+                if (!((group >> lane) & 1) || nearest_box[lane] < 0)
+                    continue;
+                const Point o(origin[0][lane], origin[1][lane], origin[2][lane]);
+                const Point d(direction[0][lane], direction[1][lane], direction[2][lane]);
+                hits[lane].voxel = tile;
+                hits[lane].box = nearest_box[lane];
+                finalizeHit(hits[lane], o, d, o + d*nearest_distance[lane], scene);
+                active &= ~(1u << lane);
+            }
+        }
+
+        // Remaining lanes move to their next voxel, stopping like the scalar loop when the boundary point leaves the scene
+        for (int lane=0; lane<Width; ++lane) {
+            if (!((active >> lane) & 1))
+                continue;
+            int axis = (t_max[0][lane] < t_max[1][lane]) ? 0 : 1;
+            if (t_max[2][lane] < t_max[axis][lane])
+                axis = 2;
+            const double t = t_max[axis][lane];
+            cell[axis][lane] += cell_step[axis][lane];
+            t_max[axis][lane] += t_delta[axis][lane];
+            const Point boundary(origin[0][lane] + direction[0][lane]*t,
+                                 origin[1][lane] + direction[1][lane]*t,
+                                 origin[2][lane] + direction[2][lane]*t);
+            if (!scene.inBounds(boundary))
+                active &= ~(1u << lane);
+        }
+    }
+}
+
+template class PacketTracer<4>;
+template class PacketTracer<8>;
@@ -5,20 +5,20 @@
 
 #include <random>
 
-#include "scene.hpp"
-
-void Ray::reset(const int seed) {
+void Ray::reset(const int seed, const Point& extent) {
     std::mt19937 gen(seed);
     if (!seed) {
         std::random_device rd;
         gen = std::mt19937(rd());
     }
-    std::uniform_real_distribution<double> ori_distrib(0, CHUNK_SIDE_SIZE);
+    std::uniform_real_distribution<double> ori_x_distrib(0, extent.x());
+    std::uniform_real_distribution<double> ori_y_distrib(0, extent.y());
+    std::uniform_real_distribution<double> ori_z_distrib(0, extent.z());
     std::uniform_real_distribution<double> dir_distrib(-1, 1);
 
-    origin.x() = ori_distrib(gen);
-    origin.y() = ori_distrib(gen);
-    origin.z() = ori_distrib(gen);
+    origin.x() = ori_x_distrib(gen);
+    origin.y() = ori_y_distrib(gen);
+    origin.z() = ori_z_distrib(gen);
     direction.x() = dir_distrib(gen);
     direction.y() = dir_distrib(gen);
     direction.z() = dir_distrib(gen);
@@ -2,7 +2,11 @@
  * @file ray_algorithm.cpp
  */
 #include "ray_algorithm.hpp"
+
+#include <cassert>
+
 #include "util.hpp"
+#include "simd.hpp"
 
 /**
  * Helper function for slab algorithm
@@ -49,24 +53,94 @@ bool slabsRayHitsBox(const Point& origin, const Point& direction, const AABB& bo
     return true;
 }
 
-bool SlabAlgorithm::computeStep(Ray& ray, const SandboxScene& scene) {
-    Point prev_point = ray.getLastTracePoint();
-    auto next_tile = VoxelPosition(prev_point + ray.getDirection()*1e-5);
-    if (!scene.inBounds(next_tile))
-        return false;
-    auto boxes = scene.getVoxel(next_tile).getContents();
-
+/**
+ * Slab test of every box of a voxel, keeping the closest box hit.
+ * @param   origin          Origin of the ray relative to the voxel.
+ * @param   direction       Normalized direction of the ray.
+ * @param   boxes           Boxes of the shape of the voxel.
+ * @param   tile            Voxel tested, recorded in hit with the index of the closest box.
+ * @param   min_distance    Distance to the closest box hit so far, lowered when a closer box is hit.
+ * @param   hit             Voxel and box of the closest hit so far.
+ * @return  True if a box of the voxel is hit.
+ */
+static inline bool slabsNearestBox(const Point& origin, const Point& direction, const std::span<const AABB> boxes,
+                                   const VoxelPosition& tile, double& min_distance, Hit& hit) {
     bool hits_something = false;
-    double min_distance = HUGE_VAL;
-    for (auto& box: boxes) {
+    for (size_t i=0; i<boxes.size(); ++i) {
         double distance_to_box;
-        Point origin_relative = prev_point - Point(next_tile.x, next_tile.y, next_tile.z);
-        if (slabsRayHitsBox(origin_relative, ray.getDirection(), box, distance_to_box)) {
+        if (slabsRayHitsBox(origin, direction, boxes[i], distance_to_box)) {
             hits_something = true;
-            if (distance_to_box < min_distance)
+            if (distance_to_box < min_distance) {
                 min_distance = distance_to_box;
+                hit.voxel = tile;
+                hit.box = (int)i;
+            }
         }
     }
+    return hits_something;
+}
+
+/**
+ * Moves a ray whose next voxel is outside of the scene out of it, so that the traversal ends.
+ * @note The last boundary point may be rounded back inside the scene.
+ * @param   ray     Ray leaving the scene.
+ */
+static inline void pushOutOfScene(Ray& ray) {
+    ray.addTrace(ray.getLastTracePoint() + ray.getDirection()*RAY_NUDGE);
+}
+
+template<VoxelScene Scene>
+void finalizeHit(Hit& hit, const Point& origin, const Point& direction, const Point& hit_point, const Scene& scene) {
+    hit.found = true;
+    hit.distance = (hit_point - origin).dot(direction);
+
+    // The hit face is the one of the box the closest to the hit point
+    const AABB& box = scene.getVoxel(hit.voxel).getContents()[hit.box];
+    const Point local = hit_point - Point(hit.voxel.x, hit.voxel.y, hit.voxel.z);
+    int face_axis = 0;
+    double face_distance = HUGE_VAL;
+    for (int axis=0; axis<3; ++axis) {
+        const double d = std::min(std::abs(local[axis] - box.min[axis]), std::abs(local[axis] - box.max[axis]));
+        if (d < face_distance) {
+            face_distance = d;
+            face_axis = axis;
+        }
+    }
+    hit.normal = Point();
+    hit.normal[face_axis] = direction[face_axis] > 0 ? -1. : 1.;
+}
+
+template<typename Algorithm, VoxelScene Scene>
+Hit traceRayStatic(Algorithm& algorithm, Ray& ray, const Scene& scene) {
+    Hit hit;
+    Point ray_pos = ray.getLastTracePoint();
+    while (scene.inBounds(ray_pos)) {
+        if (algorithm.kernelStep(ray, scene, hit)) {
+            finalizeHit(hit, ray.getOrigin(), ray.getDirection(), ray.getLastTracePoint(), scene);
+            break;
+        }
+        ray_pos = ray.getLastTracePoint();
+    }
+    return hit;
+}
+
+template<VoxelScene Scene>
+bool SlabAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
+    Point prev_point = ray.getLastTracePoint();
+    auto next_tile = VoxelPosition(prev_point + ray.getDirection()*RAY_NUDGE);
+    if (!scene.inBounds(next_tile)) {
+        pushOutOfScene(ray);
+        return false;
+    }
+
+    bool hits_something = false;
+    double min_distance = HUGE_VAL;
+    // Empty voxels are skipped with the occupancy mask, without fetching their boxes
+    if (scene.isOccupied(next_tile)) {
+        const Point origin_relative = prev_point - Point(next_tile.x, next_tile.y, next_tile.z);
+        hits_something = slabsNearestBox(origin_relative, ray.getDirection(), scene.getVoxel(next_tile).getContents(),
+                                         next_tile, min_distance, hit);
+    }
 
     if (hits_something) {
         // Advance to the AABB that is hit
@@ -95,38 +169,28 @@ bool SlabAlgorithm::computeStep(Ray& ray, const SandboxScene& scene) {
     return hits_something;
 }
 
-bool MarchingSlabAlgorithm::computeStep(Ray& ray, const SandboxScene& scene) {
+template<VoxelScene Scene>
+bool MarchingSlabAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
     Point prev_point = ray.getLastTracePoint();
 
     // Unlike the classical algorithm, collision candidates may be in the current tile or in the next one
     auto current_tile = VoxelPosition(prev_point);
-    auto boxes = scene.getVoxel(current_tile).getContents();
 
     bool hits_something = false;
     double min_distance = HUGE_VAL;
 
-    for (auto& box: boxes) {
-        double distance_to_box;
-        Point origin_relative = prev_point - Point(current_tile.x, current_tile.y, current_tile.z);
-        if (slabsRayHitsBox(origin_relative, ray.getDirection(), box, distance_to_box)) {
-            hits_something = true;
-            if (distance_to_box < min_distance)
-                min_distance = distance_to_box;
-        }
+    if (scene.isOccupied(current_tile)) {
+        const Point origin_relative = prev_point - Point(current_tile.x, current_tile.y, current_tile.z);
+        hits_something = slabsNearestBox(origin_relative, ray.getDirection(), scene.getVoxel(current_tile).getContents(),
+                                         current_tile, min_distance, hit);
     }
 
     auto next_tile = VoxelPosition(prev_point + ray.getDirection()*this->step);
-    if (!hits_something && current_tile != next_tile && scene.inBounds(next_tile)) {
-        auto next_boxes = scene.getVoxel(next_tile).getContents();
-        for (auto& box: next_boxes) {
-            double distance_to_box;
-            Point origin_relative = prev_point - Point(next_tile.x, next_tile.y, next_tile.z);
-            if (slabsRayHitsBox(origin_relative, ray.getDirection(), box, distance_to_box)) {
-                hits_something = true;
-                if (distance_to_box < min_distance)
-                    min_distance = distance_to_box;
-            }
-        }
+    if (!hits_something && current_tile != next_tile && scene.inBounds(next_tile)
+        && scene.isOccupied(next_tile)) {
+        const Point origin_relative = prev_point - Point(next_tile.x, next_tile.y, next_tile.z);
+        hits_something = slabsNearestBox(origin_relative, ray.getDirection(), scene.getVoxel(next_tile).getContents(),
+                                         next_tile, min_distance, hit);
     }
 
     if (hits_something) {
@@ -192,26 +256,49 @@ bool bitmaskRayHitsBox(const Point& new_pos, const Point& direction, const AABB&
         return false;
 }
 
-bool BitmaskAlgorithm::computeStep(Ray& ray, const SandboxScene& scene) {
+/**
+ * Bitmask test of every box of a voxel, keeping the closest box hit.
+ * @param   ray_pos         Current position of the ray.
+ * @param   direction       Normalized direction of the ray.
+ * @param   boxes           Boxes of the shape of the voxel.
+ * @param   tile            Voxel tested, recorded in hit with the index of the closest box.
+ * @param   min_distance    Distance to the closest box hit so far, lowered when a closer box is hit.
+ * @param   hit             Voxel and box of the closest hit so far.
+ * @return  True if a box of the voxel is hit.
+ */
+static inline bool bitmaskNearestBox(const Point& ray_pos, const Point& direction, const std::span<const AABB> boxes,
+                                     const VoxelPosition& tile, double& min_distance, Hit& hit) {
+    bool hits_something = false;
+    for (size_t i=0; i<boxes.size(); ++i) {
+        const AABB& box = boxes[i];
+        const Point new_pos = ray_pos - (box.center() + Point(tile.x, tile.y, tile.z));
+        double distance;
+        if (bitmaskRayHitsBox(new_pos, direction, box, distance)) {
+            if (distance < min_distance) {
+                min_distance = distance;
+                hit.voxel = tile;
+                hit.box = (int)i;
+            }
+            hits_something = true;
+        }
+    }
+    return hits_something;
+}
+
+template<VoxelScene Scene>
+bool BitmaskAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
     // Get the last trace point and get the associated voxel to test
     const Point ray_pos = ray.getLastTracePoint();
-    VoxelPosition vp(ray_pos + (ray.getDirection()*1e-5));
-    Voxel curr_voxel = scene.getVoxel(vp);
+    VoxelPosition vp(ray_pos + (ray.getDirection()*RAY_NUDGE));
 
     // Only keep the closest hit
     bool hits_something = false;
     double min_distance = HUGE_VAL;
 
-    // Check all the AABBs of the current voxel to check for intersection
-    for (const AABB& box : curr_voxel.getContents()) {
-        Point new_pos = ray_pos - (box.center() + Point(vp.x, vp.y, vp.z));
-        double distance;
-        if (bitmaskRayHitsBox(new_pos, ray.getDirection(), box, distance)) {
-            if (distance < min_distance)
-                min_distance = distance;
-            hits_something = true;
-        }
-    }
+    // Check all the AABBs of the current voxel to check for intersection, empty voxels are skipped
+    if (scene.isOccupied(vp))
+        hits_something = bitmaskNearestBox(ray_pos, ray.getDirection(), scene.getVoxel(vp).getContents(),
+                                           vp, min_distance, hit);
 
     if (hits_something) {
         Point new_point(ray_pos + ray.getDirection()*min_distance);
@@ -239,42 +326,27 @@ bool BitmaskAlgorithm::computeStep(Ray& ray, const SandboxScene& scene) {
     }
 }
 
-bool MarchingBitmaskAlgorithm::computeStep(Ray& ray, const SandboxScene& scene) {
+template<VoxelScene Scene>
+bool MarchingBitmaskAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
     // Get the last trace point and get the associated voxel to test
     const Point ray_pos = ray.getLastTracePoint();
     VoxelPosition curr_tile(ray_pos);
 
     // Unlike the classical algorithm, collision candidates may be in the current tile or in the next one
-    Voxel curr_voxel = scene.getVoxel(curr_tile);
-
     // Only keep the closest hit
     bool hits_something = false;
     double min_distance = HUGE_VAL;
 
     // Check all the AABBs of the current voxel to check for intersection
-    for (const AABB& box : curr_voxel.getContents()) {
-        Point new_pos = ray_pos - (box.center() + Point(curr_tile.x, curr_tile.y, curr_tile.z));
-        double distance;
-        if (bitmaskRayHitsBox(new_pos, ray.getDirection(), box, distance)) {
-            if (distance < min_distance)
-                min_distance = distance;
-            hits_something = true;
-        }
-    }
+    if (scene.isOccupied(curr_tile))
+        hits_something = bitmaskNearestBox(ray_pos, ray.getDirection(), scene.getVoxel(curr_tile).getContents(),
+                                           curr_tile, min_distance, hit);
 
     VoxelPosition next_tile(ray_pos + ray.getDirection()*this->step);
-    if (!hits_something && curr_tile != next_tile && scene.inBounds(next_tile)) {
-        Voxel next_boxes = scene.getVoxel(next_tile);
-        for (const AABB& box : next_boxes.getContents()) {
-            double distance;
-            Point new_pos = ray_pos - (box.center() + Point(next_tile.x, next_tile.y, next_tile.z));
-            if (bitmaskRayHitsBox(new_pos, ray.getDirection(), box, distance)) {
-                if (distance < min_distance)
-                    min_distance = distance;
-                hits_something = true;
-            }
-        }
-    }
+    if (!hits_something && curr_tile != next_tile && scene.inBounds(next_tile)
+        && scene.isOccupied(next_tile))
+        hits_something = bitmaskNearestBox(ray_pos, ray.getDirection(), scene.getVoxel(next_tile).getContents(),
+                                           next_tile, min_distance, hit);
 
     if (hits_something) {
         Point new_point(ray_pos + ray.getDirection()*min_distance);
@@ -287,3 +359,406 @@ bool MarchingBitmaskAlgorithm::computeStep(Ray& ray, const SandboxScene& scene)
     }
 }
 
+template<VoxelScene Scene>
+bool DistanceMarchingAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
+    assert(field && field_revision == scene.revision());
+    if (ray.getStepCount() == 0)
+        t = 0.;
+
+    const Point origin = ray.getOrigin();
+    const Point direction = ray.getDirection();
+
+    // The voxel is taken slightly ahead so that a point on a boundary belongs to the voxel being entered, and rounded
+    // down so that a point just before the scene is not truncated into it
+    const Point ahead = origin + direction*(t + RAY_NUDGE);
+    const VoxelPosition tile((int)std::floor(ahead.x()), (int)std::floor(ahead.y()), (int)std::floor(ahead.z()));
+    if (!scene.inBounds(tile)) {
+        pushOutOfScene(ray);
+        return false;
+    }
+
+    const int distance = field->distance(tile);
+    if (distance == 0) {
+        double min_distance = HUGE_VAL;
+        const Point origin_relative = origin - Point(tile.x, tile.y, tile.z);
+        if (slabsNearestBox(origin_relative, direction, scene.getVoxel(tile).getContents(), tile, min_distance, hit)) {
+            ray.addTrace(origin + direction*min_distance);
+            return true;
+        }
+    }
+
+    // Every voxel closer than the distance is empty, the ray can go straight to the border of their cube
+    const int radius = std::max(distance, 1) - 1;
+    double t_exit = HUGE_VAL;
+    for (int axis=0; axis<3; ++axis) {
+        const int voxel = axis == 0 ? tile.x : (axis == 1 ? tile.y : tile.z);
+        if (direction[axis] > 0)
+            t_exit = std::min(t_exit, (voxel + radius + 1 - origin[axis]) / direction[axis]);
+        else if (direction[axis] < 0)
+            t_exit = std::min(t_exit, (voxel - radius - origin[axis]) / direction[axis]);
+    }
+    t = std::max(t_exit, t);
+    ray.addTrace(origin + direction*t);
+    return false;
+}
+
+void DDATraversal::initialize(const Ray& ray) {
+    const Point origin = ray.getOrigin();
+    const Point direction = ray.getDirection();
+
+    for (int axis=0; axis<3; ++axis) {
+        cell[axis] = (int)std::floor(origin[axis]);
+        if (direction[axis] > 0) {
+            cell_step[axis] = 1;
+            t_delta[axis] = 1. / direction[axis];
+            t_max[axis] = (cell[axis] + 1 - origin[axis]) * t_delta[axis];
+        } else if (direction[axis] < 0) {
+            cell_step[axis] = -1;
+            t_delta[axis] = -1. / direction[axis];
+            t_max[axis] = (origin[axis] - cell[axis]) * t_delta[axis];
+        } else {
+            // The ray never crosses a boundary on this axis
+            cell_step[axis] = 0;
+            t_delta[axis] = HUGE_VAL;
+            t_max[axis] = HUGE_VAL;
+        }
+    }
+}
+
+void DDATraversal::advance(Ray& ray) {
+    ray.addTrace(ray.getOrigin() + ray.getDirection()*advanceCell());
+}
+
+void DDATraversal::enterAt(Ray& ray, const double t, const int axis, const std::array<int, 3>& low,
+                           const std::array<int, 3>& high) {
+    const Point origin = ray.getOrigin();
+    const Point direction = ray.getDirection();
+
+    for (int a=0; a<3; ++a) {
+        const double entry = origin[a] + direction[a]*t;
+        if (a == axis)
+            cell[a] = cell_step[a] > 0 ? low[a] : high[a];
+        else if (cell_step[a] > 0)
+            cell[a] = std::clamp((int)std::floor(entry), low[a], high[a]);
+        else if (cell_step[a] < 0)
+            // A point on a boundary belongs to the voxel below it when going down
+            cell[a] = std::clamp((int)std::ceil(entry) - 1, low[a], high[a]);
+
+        if (cell_step[a] > 0)
+            t_max[a] = (cell[a] + 1 - origin[a]) * t_delta[a];
+        else if (cell_step[a] < 0)
+            t_max[a] = (origin[a] - cell[a]) * t_delta[a];
+    }
+    ray.addTrace(origin + direction*t);
+}
+
+void DDATraversal::crossRegion(Ray& ray, const VoxelPosition& min, const VoxelPosition& max) {
+    const Point origin = ray.getOrigin();
+    std::array<int, 3> low = {min.x, min.y, min.z};
+    std::array<int, 3> high = {max.x, max.y, max.z};
+
+    // The ray leaves the region through the first face it reaches
+    int exit_axis = 0;
+    double t_exit = HUGE_VAL;
+    for (int axis=0; axis<3; ++axis) {
+        double t = HUGE_VAL;
+        if (cell_step[axis] > 0)
+            t = (high[axis] + 1 - origin[axis]) * t_delta[axis];
+        else if (cell_step[axis] < 0)
+            t = (origin[axis] - low[axis]) * t_delta[axis];
+        if (t < t_exit) {
+            t_exit = t;
+            exit_axis = axis;
+        }
+    }
+
+    // The voxel entered is past the exit face, and within the region on the other axes
+    if (cell_step[exit_axis] > 0)
+        low[exit_axis] = high[exit_axis] + 1;
+    else
+        high[exit_axis] = low[exit_axis] - 1;
+    enterAt(ray, t_exit, exit_axis, low, high);
+}
+
+template<typename Policy, VoxelScene Scene>
+bool DDATraversal::step(Policy& policy, Ray& ray, const Scene& scene, Hit& hit) {
+    if (ray.getStepCount() == 0) {
+        initialize(ray);
+        policy.beginRay(ray);
+    }
+
+    const Point origin = ray.getOrigin();
+    const Point direction = ray.getDirection();
+
+    const VoxelPosition tile(cell);
+    if (!scene.inBounds(tile)) {
+        pushOutOfScene(ray);
+        return false;
+    }
+
+    if (policy.crossEmpty(ray, scene, tile))
+        return false;
+
+    double distance = HUGE_VAL;
+    if (policy.testVoxel(scene, tile, origin - Point(tile.x, tile.y, tile.z), direction, distance, hit)) {
+        ray.addTrace(origin + direction*distance);
+        return true;
+    }
+
+    advance(ray);
+    return false;
+}
+
+template<VoxelScene Scene>
+bool DDATraversal::crossEmpty(Ray& ray, const Scene& scene, const VoxelPosition& tile) {
+    // Whole empty sections are crossed at once
+    VoxelPosition region_min(0, 0, 0), region_max(0, 0, 0);
+    if (!scene.findEmptyRegion(tile, region_min, region_max))
+        return false;
+    crossRegion(ray, region_min, region_max);
+    return true;
+}
+
+template<VoxelScene Scene>
+bool DDAAlgorithm::testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin, const Point& direction,
+                             double& distance, Hit& hit) {
+    // Only occupied voxels need a slab test
+    return scene.isOccupied(tile)
+        && slabsNearestBox(origin, direction, scene.getVoxel(tile).getContents(), tile, distance, hit);
+}
+
+template<VoxelScene Scene>
+bool DDAAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
+    return step(*this, ray, scene, hit);
+}
+
+void SimdSlabAlgorithm::beginRay(const Ray& ray) {
+    for (int axis=0; axis<3; ++axis)
+        inv_direction[axis] = 1. / ray.getDirection()[axis];
+}
+
+template<VoxelScene Scene>
+bool SimdSlabAlgorithm::testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin,
+                                  const Point& direction, double& distance, Hit& hit) {
+    if (!scene.isOccupied(tile))
+        return false;
+
+    // All the boxes of an occupied voxel are tested at once
+    const ShapeId shape = scene.getShapeId(tile);
+    const ShapeTable& shapes = scene.getShapes();
+    const int box = simdSlabsNearestBox(origin, direction, inv_direction, shapes.getShapeBlocks(shape),
+                                        shapes.getBoxCount(shape), distance);
+    if (box < 0)
+        return false;
+    hit.voxel = tile;
+    hit.box = box;
+    return true;
+}
+
+template<VoxelScene Scene>
+bool SimdSlabAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
+    return step(*this, ray, scene, hit);
+}
+
+template<VoxelScene Scene>
+bool SvoAlgorithm::crossEmpty(Ray& ray, const Scene&, const VoxelPosition& tile) {
+    // Empty octants are crossed at once, whatever their size
+    VoxelPosition region_min(0, 0, 0), region_max(0, 0, 0);
+    if (octree->lookup(tile, leaf_shape, region_min, region_max)) {
+        ++voxel_steps;
+        return false;
+    }
+    ++octant_steps;
+    crossRegion(ray, region_min, region_max);
+    return true;
+}
+
+template<VoxelScene Scene>
+bool SvoAlgorithm::testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin, const Point& direction,
+                             double& distance, Hit& hit) {
+    // The leaf gives the shape, the scene is not read
+    return slabsNearestBox(origin, direction, scene.getShapes().getShape(leaf_shape), tile, distance, hit);
+}
+
+template<VoxelScene Scene>
+bool SvoAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
+    assert(octree && octree_revision == scene.revision());
+    return step(*this, ray, scene, hit);
+}
+
+template<VoxelScene Scene>
+bool BrickmapAlgorithm::crossEmpty(Ray& ray, const Scene&, const VoxelPosition& tile) {
+    if (brickmap->isBrickOccupied(tile.x, tile.y, tile.z))
+        return false;
+
+    // Brick resolution: a DDA over bricks, whose cells are brick_side voxels wide, walks the empty bricks without
+    // reading the scene
+    const Point origin = ray.getOrigin();
+    const int side = brickmap->brickSide();
+    std::array<int, 3> brick;
+    std::array<double, 3> brick_t_max, brick_t_delta;
+    for (int axis=0; axis<3; ++axis) {
+        brick[axis] = cell[axis] & ~(side-1);
+        brick_t_delta[axis] = t_delta[axis] * side;
+        if (cell_step[axis] > 0)
+            brick_t_max[axis] = (brick[axis] + side - origin[axis]) * t_delta[axis];
+        else if (cell_step[axis] < 0)
+            brick_t_max[axis] = (origin[axis] - brick[axis]) * t_delta[axis];
+        else
+            brick_t_max[axis] = HUGE_VAL;
+    }
+    int axis;
+    double t;
+    do {
+        axis = (brick_t_max[0] < brick_t_max[1]) ? 0 : 1;
+        if (brick_t_max[2] < brick_t_max[axis])
+            axis = 2;
+        t = brick_t_max[axis];
+        brick[axis] += cell_step[axis] * side;
+        brick_t_max[axis] += brick_t_delta[axis];
+        ++brick_steps;
+    } while (brickmap->inBounds(brick[0], brick[1], brick[2])
+             && !brickmap->isBrickOccupied(brick[0], brick[1], brick[2]));
+
+    // Voxel resolution again from the point where the ray enters the occupied brick
+    enterAt(ray, t, axis, brick, {brick[0] + side-1, brick[1] + side-1, brick[2] + side-1});
+    return true;
+}
+
+template<VoxelScene Scene>
+bool BrickmapAlgorithm::testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin,
+                                  const Point& direction, double& distance, Hit& hit) {
+    // Voxel resolution inside an occupied brick
+    ++voxel_steps;
+    return scene.isOccupied(tile)
+        && slabsNearestBox(origin, direction, scene.getVoxel(tile).getContents(), tile, distance, hit);
+}
+
+template<VoxelScene Scene>
+bool BrickmapAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
+    assert(brickmap && brickmap_revision == scene.revision());
+    return step(*this, ray, scene, hit);
+}
+
+bool SubvoxelAlgorithm::crossesMask(const Point& origin, const Point& direction, const uint64_t mask) const {
+    // The ray entered the voxel on its last boundary crossed, the first voxel is entered at the origin
+    double t_in = 0.;
+    for (int axis=0; axis<3; ++axis)
+        if (cell_step[axis] != 0)
+            t_in = std::max(t_in, t_max[axis] - t_delta[axis]);
+
+    // Same traversal as the voxels, with cells SUBVOXEL_SIDE times smaller
+    std::array<int, 3> sub_cell;
+    std::array<double, 3> sub_t_max, sub_t_delta;
+    for (int axis=0; axis<3; ++axis) {
+        const double entry = (origin[axis] + direction[axis]*t_in) * SUBVOXEL_SIDE;
+        sub_cell[axis] = std::clamp((int)std::floor(entry), 0, SUBVOXEL_SIDE-1);
+        sub_t_delta[axis] = t_delta[axis] / SUBVOXEL_SIDE;
+        if (cell_step[axis] > 0)
+            sub_t_max[axis] = t_in + (sub_cell[axis] + 1 - entry) * sub_t_delta[axis];
+        else if (cell_step[axis] < 0)
+            sub_t_max[axis] = t_in + (entry - sub_cell[axis]) * sub_t_delta[axis];
+        else
+            sub_t_max[axis] = HUGE_VAL;
+    }
+
+    while (true) {
+        if ((mask >> ((sub_cell[1]*SUBVOXEL_SIDE + sub_cell[2])*SUBVOXEL_SIDE + sub_cell[0])) & 1)
+            return true;
+        int axis = (sub_t_max[0] < sub_t_max[1]) ? 0 : 1;
+        if (sub_t_max[2] < sub_t_max[axis])
+            axis = 2;
+        sub_cell[axis] += cell_step[axis];
+        if (sub_cell[axis] < 0 || sub_cell[axis] >= SUBVOXEL_SIDE)
+            return false;
+        sub_t_max[axis] += sub_t_delta[axis];
+    }
+}
+
+template<VoxelScene Scene>
+bool SubvoxelAlgorithm::testVoxel(const Scene& scene, const VoxelPosition& tile, const Point& origin,
+                                  const Point& direction, double& distance, Hit& hit) {
+    if (!scene.isOccupied(tile))
+        return false;
+
+    ++occupied_steps;
+    const ShapeId shape = scene.getShapeId(tile);
+    const uint64_t mask = scene.getShapes().getSubvoxelMask(shape);
+    // Only the rays crossing a cell of the mask can hit a box, full blocks skip the walk
+    if (mask != ~(uint64_t)0 && !crossesMask(origin, direction, mask)) {
+        ++rejected_steps;
+        return false;
+    }
+    return slabsNearestBox(origin, direction, scene.getShapes().getShape(shape), tile, distance, hit);
+}
+
+template<VoxelScene Scene>
+bool SubvoxelAlgorithm::kernelStep(Ray& ray, const Scene& scene, Hit& hit) {
+    return step(*this, ray, scene, hit);
+}
+
+template<typename Derived>
+bool StaticRayAlgorithm<Derived>::computeStep(Ray& ray, const SandboxScene& scene) {
+    Hit hit;
+    return static_cast<Derived*>(this)->kernelStep(ray, scene, hit);
+}
+
+template<typename Derived>
+bool StaticRayAlgorithm<Derived>::computeStep(Ray& ray, const World& world) {
+    Hit hit;
+    return static_cast<Derived*>(this)->kernelStep(ray, world, hit);
+}
+
+template<typename Derived>
+Hit StaticRayAlgorithm<Derived>::traceRay(Ray& ray, const SandboxScene& scene) {
+    return traceRayStatic(*static_cast<Derived*>(this), ray, scene);
+}
+
+template<typename Derived>
+Hit StaticRayAlgorithm<Derived>::traceRay(Ray& ray, const World& world) {
+    return traceRayStatic(*static_cast<Derived*>(this), ray, world);
+}
+
+template<typename Derived>
+void StaticRayAlgorithm<Derived>::prepare(const SandboxScene& scene) {
+    static_cast<Derived*>(this)->build(scene);
+}
+
+template<typename Derived>
+void StaticRayAlgorithm<Derived>::prepare(const World& world) {
+    static_cast<Derived*>(this)->build(world);
+}
+
+// Statically dispatched kernels, one instantiation per algorithm and scene type
+template class StaticRayAlgorithm<SlabAlgorithm>;
+template class StaticRayAlgorithm<MarchingSlabAlgorithm>;
+template class StaticRayAlgorithm<BitmaskAlgorithm>;
+template class StaticRayAlgorithm<MarchingBitmaskAlgorithm>;
+template class StaticRayAlgorithm<DistanceMarchingAlgorithm>;
+template class StaticRayAlgorithm<DDAAlgorithm>;
+template class StaticRayAlgorithm<SimdSlabAlgorithm>;
+template class StaticRayAlgorithm<SvoAlgorithm>;
+template class StaticRayAlgorithm<BrickmapAlgorithm>;
+template class StaticRayAlgorithm<SubvoxelAlgorithm>;
+template Hit traceRayStatic<SlabAlgorithm, SandboxScene>(SlabAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<MarchingSlabAlgorithm, SandboxScene>(MarchingSlabAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<BitmaskAlgorithm, SandboxScene>(BitmaskAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<MarchingBitmaskAlgorithm, SandboxScene>(MarchingBitmaskAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<DDAAlgorithm, SandboxScene>(DDAAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<SimdSlabAlgorithm, SandboxScene>(SimdSlabAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<SvoAlgorithm, SandboxScene>(SvoAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<BrickmapAlgorithm, SandboxScene>(BrickmapAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<DistanceMarchingAlgorithm, SandboxScene>(DistanceMarchingAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<SubvoxelAlgorithm, SandboxScene>(SubvoxelAlgorithm&, Ray&, const SandboxScene&);
+template Hit traceRayStatic<SlabAlgorithm, World>(SlabAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<MarchingSlabAlgorithm, World>(MarchingSlabAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<BitmaskAlgorithm, World>(BitmaskAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<MarchingBitmaskAlgorithm, World>(MarchingBitmaskAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<DDAAlgorithm, World>(DDAAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<SimdSlabAlgorithm, World>(SimdSlabAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<SvoAlgorithm, World>(SvoAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<BrickmapAlgorithm, World>(BrickmapAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<DistanceMarchingAlgorithm, World>(DistanceMarchingAlgorithm&, Ray&, const World&);
+template Hit traceRayStatic<SubvoxelAlgorithm, World>(SubvoxelAlgorithm&, Ray&, const World&);
+template void finalizeHit<SandboxScene>(Hit&, const Point&, const Point&, const Point&, const SandboxScene&);
+template void finalizeHit<World>(Hit&, const Point&, const Point&, const Point&, const World&);
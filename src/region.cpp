@@ -0,0 +1,488 @@
+/**
+ * @file region.cpp
+ */
+#include "region.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <charconv>
+#include <climits>
+#include <filesystem>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <zlib.h>
+
+/**
+ * Compression schemes of the chunks of a region file, LZ4 and external chunks are not supported.
+ */
+#define REGION_COMPRESSION_GZIP 1
+#define REGION_COMPRESSION_ZLIB 2
+#define REGION_COMPRESSION_NONE 3
+
+/**
+ * Maximum nesting of NBT lists and compounds.
+ */
+#define NBT_MAX_DEPTH 512
+
+/**
+ * Types of the NBT tags.
+ */
+enum NbtTag : uint8_t {
+    NBT_END = 0,
+    NBT_BYTE,
+    NBT_SHORT,
+    NBT_INT,
+    NBT_LONG,
+    NBT_FLOAT,
+    NBT_DOUBLE,
+    NBT_BYTE_ARRAY,
+    NBT_STRING,
+    NBT_LIST,
+    NBT_COMPOUND,
+    NBT_INT_ARRAY,
+    NBT_LONG_ARRAY
+};
+
+/**
+ * Reads an unsigned big-endian integer.
+ */
+static uint64_t readBigEndian(const uint8_t* bytes, const int count) {
+    uint64_t value = 0;
+    for (int i=0; i<count; ++i)
+        value = (value << 8) | bytes[i];
+    return value;
+}
+
+/**
+ * Cursor over uncompressed NBT data.
+ * @note Reading past the end of the data marks the reader as failed and returns zeros.
+ */
+class NbtReader {
+private:
+    const uint8_t* cursor;
+    const uint8_t* end;
+    bool failed;
+
+    /**
+     * Checks that enough bytes are left, marks the reader as failed otherwise.
+     */
+    inline bool available(const size_t bytes) {
+        if (failed || (size_t)(end - cursor) < bytes)
+            failed = true;
+        return !failed;
+    }
+
+public:
+    NbtReader(std::span<const uint8_t> nbt) : cursor(nbt.data()), end(nbt.data() + nbt.size()), failed(false) {}
+
+    inline bool ok() const {
+        return !failed;
+    }
+    inline uint64_t readUnsigned(const int bytes) {
+        if (!available(bytes))
+            return 0;
+        const uint64_t value = readBigEndian(cursor, bytes);
+        cursor += bytes;
+        return value;
+    }
+    inline int8_t readByte() {
+        return (int8_t)readUnsigned(1);
+    }
+    inline int32_t readInt() {
+        return (int32_t)readUnsigned(4);
+    }
+    /**
+     * Reads the length of an array or list, negative lengths make the reader fail.
+     */
+    inline size_t readLength() {
+        const int32_t length = readInt();
+        if (length < 0)
+            failed = true;
+        return failed ? 0 : (size_t)length;
+    }
+    inline std::string_view readString() {
+        const size_t length = readUnsigned(2);
+        const uint8_t* begin = skip(length);
+        return begin ? std::string_view(reinterpret_cast<const char*>(begin), length) : std::string_view();
+    }
+    /**
+     * Skips bytes.
+     * @return  Pointer to the first byte skipped, nullptr if there are not enough bytes.
+     */
+    inline const uint8_t* skip(const size_t bytes) {
+        if (!available(bytes))
+            return nullptr;
+        const uint8_t* begin = cursor;
+        cursor += bytes;
+        return begin;
+    }
+    /**
+     * Reads the header of the next tag of a compound.
+     * @param   type    Set to the type of the tag.
+     * @param   name    Set to the name of the tag.
+     * @return  False at the end of the compound or if the reader failed.
+     */
+    inline bool nextTag(uint8_t& type, std::string_view& name) {
+        type = readUnsigned(1);
+        if (type == NBT_END || failed)
+            return false;
+        name = readString();
+        return !failed;
+    }
+    /**
+     * Skips the payload of a tag whose header has been read.
+     */
+    void skipPayload(const uint8_t type, const int depth=0) {
+        if (depth > NBT_MAX_DEPTH) {
+            failed = true;
+            return;
+        }
+        switch (type) {
+        case NBT_BYTE:
+            skip(1);
+            break;
+        case NBT_SHORT:
+            skip(2);
+            break;
+        case NBT_INT:
+        case NBT_FLOAT:
+            skip(4);
+            break;
+        case NBT_LONG:
+        case NBT_DOUBLE:
+            skip(8);
+            break;
+        case NBT_BYTE_ARRAY:
+            skip(readLength());
+            break;
+        case NBT_INT_ARRAY:
+            skip(readLength()*4);
+            break;
+        case NBT_LONG_ARRAY:
+            skip(readLength()*8);
+            break;
+        case NBT_STRING:
+            readString();
+            break;
+        case NBT_LIST: {
+            const uint8_t element_type = readUnsigned(1);
+            const size_t length = readLength();
+            for (size_t i=0; i<length && !failed; ++i)
+                skipPayload(element_type, depth+1);
+            break;
+        }
+        case NBT_COMPOUND: {
+            uint8_t tag_type;
+            std::string_view name;
+            while (nextTag(tag_type, name))
+                skipPayload(tag_type, depth+1);
+            break;
+        }
+        default:
+            failed = true;
+            break;
+        }
+    }
+};
+
+/**
+ * Reads the properties of a block state straight into their canonical string (see canonicalProperties).
+ * @note Values are read like nbt_to_json.py converts them, so integers lose their leading zeros.
+ * @param   members     Buffer receiving the name and value of every property, pointing into the NBT.
+ * @param   key         Set to the canonical string.
+ */
+static void readProperties(NbtReader& reader, std::vector<std::pair<std::string_view, std::string_view>>& members,
+                           std::string& key) {
+    members.clear();
+    key.clear();
+    uint8_t type;
+    std::string_view name;
+    while (reader.nextTag(type, name)) {
+        if (type != NBT_STRING) {
+            reader.skipPayload(type);
+            continue;
+        }
+        members.emplace_back(name, reader.readString());
+    }
+
+    // Sorted by name like the members of a JSON object
+    std::sort(members.begin(), members.end());
+    for (size_t m=0; m<members.size(); ++m) {
+        const auto& [member_name, value] = members[m];
+        if (m > 0)
+            key += ',';
+        key.append(member_name);
+        key += '=';
+        char number[24];
+        int64_t integer;
+        if (!value.empty()
+            && std::all_of(value.begin(), value.end(), [](const char c) { return std::isdigit((unsigned char)c); })
+            && std::from_chars(value.data(), value.data() + value.size(), integer).ec == std::errc())
+            key.append(number, std::to_chars(number, number + sizeof(number), integer).ptr - number);
+        else
+            key.append(value);
+    }
+}
+
+/**
+ * Reads the palette of a section and resolves the shape of each of its block states.
+ * @return  False if a block state is not in block_shapes, it is reported.
+ */
+static bool readPalette(NbtReader& reader, const BlockShapes& block_shapes, std::vector<ShapeId>& palette) {
+    // Each thread reuses its buffers, so palettes stop allocating once they fit the longest property set
+    thread_local std::vector<std::pair<std::string_view, std::string_view>> members;
+    thread_local std::string key;
+    const uint8_t element_type = reader.readUnsigned(1);
+    const size_t length = reader.readLength();
+    for (size_t i=0; i<length && reader.ok(); ++i) {
+        if (element_type != NBT_COMPOUND) {
+            reader.skipPayload(element_type);
+            continue;
+        }
+        // Blocks without properties select their first state with an empty key
+        std::string_view block_name;
+        key.clear();
+        uint8_t type;
+        std::string_view name;
+        while (reader.nextTag(type, name)) {
+            if (type == NBT_STRING && name == "Name")
+                block_name = reader.readString();
+            else if (type == NBT_COMPOUND && name == "Properties")
+                readProperties(reader, members, key);
+            else
+                reader.skipPayload(type);
+        }
+
+        // Region files may hold blocks missing from the shapes file, their chunk is not loaded rather than made wrong
+        ShapeId shape = EMPTY_SHAPE;
+        if (!block_shapes.findShape(block_name, key, shape)) {
+            std::cout << "[!] Unknown block state " << block_name << '[' << key << "]\n";
+            return false;
+        }
+        palette.push_back(shape);
+    }
+    return true;
+}
+
+/**
+ * Reads the block_states compound of a section.
+ * @return  False if a block state of the palette is unknown.
+ */
+static bool readBlockStates(NbtReader& reader, const BlockShapes& block_shapes, PackedSection& section) {
+    uint8_t type;
+    std::string_view name;
+    while (reader.nextTag(type, name)) {
+        if (type == NBT_LIST && name == "palette") {
+            if (!readPalette(reader, block_shapes, section.palette))
+                return false;
+        } else if (type == NBT_LONG_ARRAY && name == "data") {
+            section.long_count = reader.readLength();
+            section.data = reader.skip(section.long_count*8);
+        } else {
+            reader.skipPayload(type);
+        }
+    }
+    return true;
+}
+
+/**
+ * Reads the sections list of a chunk, sections without block states (light only) are dropped.
+ * @note Sections are written over the entries of sections past count, which is increased for each section kept.
+ * @return  False if a block state of a palette is unknown.
+ */
+static bool readSections(NbtReader& reader, const BlockShapes& block_shapes, std::vector<PackedSection>& sections,
+                         size_t& count) {
+    const uint8_t element_type = reader.readUnsigned(1);
+    const size_t length = reader.readLength();
+    for (size_t i=0; i<length && reader.ok(); ++i) {
+        if (element_type != NBT_COMPOUND) {
+            reader.skipPayload(element_type);
+            continue;
+        }
+        if (count == sections.size())
+            sections.push_back({0, {}, nullptr, 0});
+        PackedSection& section = sections[count];
+        section.y = 0;
+        section.palette.clear();
+        section.data = nullptr;
+        section.long_count = 0;
+        bool has_block_states = false;
+        uint8_t type;
+        std::string_view name;
+        while (reader.nextTag(type, name)) {
+            if (type == NBT_BYTE && name == "Y") {
+                section.y = reader.readByte();
+            } else if (type == NBT_COMPOUND && name == "block_states") {
+                if (!readBlockStates(reader, block_shapes, section))
+                    return false;
+                has_block_states = true;
+            } else {
+                reader.skipPayload(type);
+            }
+        }
+        if (has_block_states && !section.palette.empty())
+            ++count;
+    }
+    return true;
+}
+
+/**
+ * Unpacks the block states of a section into a scene section.
+ * @note Indices past the palette are considered empty, like in the JSON loader.
+ * @param   lazy    Keeps the block states packed in the section until one of its voxels is read.
+ * @return  False if the packed data is too short for the palette.
+ */
+static bool unpackSection(const PackedSection& packed, Section& section, const bool lazy) {
+    if (packed.palette.size() == 1) {
+        section = Section(packed.palette[0]);
+        return true;
+    }
+
+    // Indices take at least 4 bits and never span two longs, the first one being in the lowest bits
+    const int bits = std::max(4, (int)std::bit_width(packed.palette.size()-1));
+    const int per_long = 64 / bits;
+    const size_t long_count = (size_t)(SECTION_VOLUME + per_long-1) / per_long;
+    if (!packed.data || packed.long_count < long_count)
+        return false;
+
+    std::vector<uint64_t> words(long_count);
+    for (size_t l=0; l<long_count; ++l)
+        words[l] = readBigEndian(packed.data + l*8, 8);
+    section = Section(packed.palette, std::move(words), bits, lazy);
+    return true;
+}
+
+bool isRegionFile(const std::string& path) {
+    return std::filesystem::path(path).extension() == REGION_FILE_EXTENSION;
+}
+
+RegionFile::RegionFile(const std::string& regionPath)
+: data(nullptr), size(0) {
+    const int fd = open(regionPath.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) < 0 || (size_t)file_stat.st_size < REGION_HEADER_SIZE) {
+        std::cout << "Could not open the region file " << regionPath << '\n';
+        exit(-1);
+    }
+    size = file_stat.st_size;
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cout << "Could not map the region file " << regionPath << '\n';
+        exit(-1);
+    }
+    data = static_cast<const uint8_t*>(mapping);
+}
+
+RegionFile::~RegionFile() {
+    munmap(const_cast<uint8_t*>(data), size);
+}
+
+bool RegionFile::hasChunk(const int index) const {
+    return readBigEndian(data + 4*index, 4) != 0;
+}
+
+bool RegionFile::readChunk(const int index, std::vector<uint8_t>& nbt) const {
+    // Location of the chunk: offset in sectors on 3 bytes, then its size in sectors
+    const uint64_t location = readBigEndian(data + 4*index, 4);
+    const size_t offset = (size_t)(location >> 8) * REGION_SECTOR_SIZE;
+    if (location == 0 || offset < REGION_HEADER_SIZE || offset + 5 > size)
+        return false;
+
+    // Length of the payload (compression byte included), compression scheme then payload
+    const size_t length = readBigEndian(data + offset, 4);
+    const uint8_t compression = data[offset + 4];
+    if (length < 1 || offset + 4 + length > size)
+        return false;
+    const uint8_t* payload = data + offset + 5;
+    const size_t payload_size = length - 1;
+
+    if (compression == REGION_COMPRESSION_NONE) {
+        nbt.assign(payload, payload + payload_size);
+        return true;
+    }
+    if (compression != REGION_COMPRESSION_ZLIB && compression != REGION_COMPRESSION_GZIP)
+        return false;
+
+    // 32 lets zlib detect the zlib and gzip headers by itself
+    z_stream stream = {};
+    if (inflateInit2(&stream, 32 + MAX_WBITS) != Z_OK)
+        return false;
+    stream.next_in = const_cast<Bytef*>(payload);
+    stream.avail_in = payload_size;
+    nbt.resize(std::max(nbt.capacity(), payload_size*4));
+    int status;
+    do {
+        if (stream.total_out == nbt.size())
+            nbt.resize(nbt.size()*2);
+        stream.next_out = nbt.data() + stream.total_out;
+        stream.avail_out = nbt.size() - stream.total_out;
+        status = inflate(&stream, Z_NO_FLUSH);
+    } while (status == Z_OK);
+    nbt.resize(stream.total_out);
+    inflateEnd(&stream);
+    return status == Z_STREAM_END;
+}
+
+ChunkDecoder::ChunkDecoder(const bool lazy_sections)
+: nbt_buffer(), sections(), section_count(0), lazy_sections(lazy_sections) {}
+
+bool ChunkDecoder::readChunk(const RegionFile& region, const int index, const BlockShapes& block_shapes,
+                             ChunkPosition& position, SandboxScene& chunk) {
+    return region.readChunk(index, nbt_buffer) && decode(nbt_buffer, block_shapes, position, chunk);
+}
+
+bool ChunkDecoder::decode(std::span<const uint8_t> nbt, const BlockShapes& block_shapes, ChunkPosition& position,
+                          SandboxScene& chunk) {
+    NbtReader reader(nbt);
+    section_count = 0;
+    bool has_x = false, has_z = false;
+    int y_pos = INT_MAX;
+
+    // The root of the chunk is an unnamed compound
+    if (reader.readUnsigned(1) != NBT_COMPOUND)
+        return false;
+    reader.readString();
+    uint8_t type;
+    std::string_view name;
+    while (reader.nextTag(type, name)) {
+        if (type == NBT_INT && name == "xPos") {
+            position.x = reader.readInt();
+            has_x = true;
+        } else if (type == NBT_INT && name == "zPos") {
+            position.z = reader.readInt();
+            has_z = true;
+        } else if (type == NBT_INT && name == "yPos") {
+            y_pos = reader.readInt();
+        } else if (type == NBT_LIST && name == "sections") {
+            if (!readSections(reader, block_shapes, sections, section_count))
+                return false;
+        } else {
+            reader.skipPayload(type);
+        }
+    }
+    if (!reader.ok() || !has_x || !has_z)
+        return false;
+
+    // The chunk spans from the section yPos to the highest section
+    const std::span<const PackedSection> chunk_sections(sections.data(), section_count);
+    int min_y = y_pos, max_y = INT_MIN;
+    for (const PackedSection& section : chunk_sections) {
+        min_y = std::min(min_y, section.y);
+        max_y = std::max(max_y, section.y);
+    }
+    if (chunk_sections.empty())
+        min_y = max_y = (y_pos == INT_MAX) ? 0 : y_pos;
+
+    chunk = SandboxScene(CHUNK_SIDE_SIZE, (max_y - min_y + 1)*SECTION_SIDE_SIZE, CHUNK_SIDE_SIZE,
+                         block_shapes.getShapeTable());
+    for (const PackedSection& section : chunk_sections)
+        if (!unpackSection(section, chunk.getSection(0, section.y - min_y, 0), lazy_sections))
+            return false;
+    return true;
+}
@@ -4,28 +4,99 @@
 #include "scene.hpp"
 
 #include <fstream>
+#include <iostream>
 #include <cassert>
+#include <climits>
+#include <cstdlib>
+#include <atomic>
 
 #include <json/json.h>
 
-#include "util.hpp"
 #include "geometry.hpp"
 
+/**
+ * Amount of sections needed to cover a size in voxels.
+ */
+static int sectionCount(const int size) {
+    return (size + SECTION_SIDE_SIZE-1) / SECTION_SIDE_SIZE;
+}
 
-SandboxScene::SandboxScene(const std::string& chunkPath, const std::string& shapesPath,
-                           const int chosen_section)
-: voxels(CHUNK_SIDE_SIZE, std::vector<std::vector<Voxel>>(
-            CHUNK_SIDE_SIZE, std::vector<Voxel>(
-                CHUNK_SIDE_SIZE, Voxel()))) {
-    // Checks if files exists
+uint64_t nextSceneRevision() {
+    static std::atomic<uint64_t> last_revision(0);
+    return ++last_revision;
+}
+
+SandboxScene::SandboxScene(const int width, const int height, const int depth,
+                           std::shared_ptr<const ShapeTable> table)
+: width(width), height(height), depth(depth),
+  sections(sectionCount(width), sectionCount(height), sectionCount(depth), Section()), shapes(std::move(table)),
+  scene_revision(nextSceneRevision()) {}
+
+/**
+ * Checks that a chunk JSON document only holds values of the types read by SandboxScene, and known block states.
+ */
+static bool validChunk(const Json::Value& chunkData, const BlockShapes& block_shapes) {
+    if (!chunkData.isObject() || !chunkData["xPos"].isInt() || !chunkData["zPos"].isInt()
+        || !chunkData["sections"].isArray())
+        return false;
+    if (chunkData.isMember("yPos") && !chunkData["yPos"].isInt())
+        return false;
+    for (const Json::Value& section : chunkData["sections"]) {
+        if (!section.isObject() || !section["Y"].isInt())
+            return false;
+        const Json::Value& palette = section["palette"];
+        if (!palette.isArray() && !palette.isNull())
+            return false;
+        for (const Json::Value& block : palette) {
+            if (!block.isObject() || !block["Name"].isString())
+                return false;
+            ShapeId shape;
+            std::string key;
+            canonicalProperties(block["Properties"], key);
+            if (!block_shapes.findShape(block["Name"].asString(), key, shape)) {
+                std::cout << "[!] Unknown block state " << block["Name"].asString() << '[' << key << "]\n";
+                return false;
+            }
+        }
+        if (palette.size() <= 1)
+            continue;
+        const Json::Value& data = section["data"];
+        if (!data.isArray())
+            return false;
+        for (const Json::Value& block_id : data)
+            if (!block_id.isUInt())
+                return false;
+    }
+    return true;
+}
+
+bool readChunkFile(const std::string& chunkPath, const BlockShapes& block_shapes, Json::Value& chunkData) {
     std::ifstream chunkFile(chunkPath, std::ios_base::in);
-    std::ifstream shapesFile(shapesPath, std::ios_base::in);
+    if (!chunkFile)
+        return false;
+    // Parse errors are returned rather than thrown, so that a worker thread can skip the file
+    Json::CharReaderBuilder builder;
+    std::string errors;
+    return Json::parseFromStream(builder, chunkFile, &chunkData, &errors) && validChunk(chunkData, block_shapes);
+}
 
-    // Loads JSON files
+/**
+ * Parses a chunk JSON file, exits if it can not be read.
+ */
+static Json::Value readChunk(const std::string& chunkPath, const BlockShapes& block_shapes) {
     Json::Value chunkData;
-    Json::Value shapesData;
-    chunkFile >> chunkData;
-    shapesFile >> shapesData;
+    if (!readChunkFile(chunkPath, block_shapes, chunkData)) {
+        std::cout << "Could not read the chunk file " << chunkPath << '\n';
+        exit(-1);
+    }
+    return chunkData;
+}
+
+SandboxScene::SandboxScene(const std::string& chunkPath, const BlockShapes& block_shapes,
+                           const int chosen_section)
+: SandboxScene(CHUNK_SIDE_SIZE, CHUNK_SIDE_SIZE, CHUNK_SIDE_SIZE, block_shapes.getShapeTable()) {
+    // Loads JSON file
+    const Json::Value chunkData = readChunk(chunkPath, block_shapes);
 
     // Get the JSON Array of Y sections
     const Json::Value sections = chunkData["sections"];
@@ -37,78 +108,103 @@ SandboxScene::SandboxScene(const std::string& chunkPath, const std::string& shap
     while (sections[section_index]["Y"] != chosen_section)
         ++section_index;
 
-    // Get the block palette for the current Y
-    const Json::Value palette = sections[section_index]["palette"];
+    loadSection(sections[section_index], block_shapes, 0);
+}
 
-    // Grid of 256 at height y
-    // voxels[y].resize(16, std::vector<Voxel>());// Z
+SandboxScene::SandboxScene(const std::string& chunkPath, const BlockShapes& block_shapes)
+: SandboxScene(readChunk(chunkPath, block_shapes), block_shapes) {}
 
-    // Get the AABB of all the blocks in the palette
+SandboxScene::SandboxScene(const Json::Value& chunkData, const BlockShapes& block_shapes)
+: SandboxScene(0, 0, 0, block_shapes.getShapeTable()) {
+    const Json::Value& chunk_sections = chunkData["sections"];
+
+    // The scene spans from the lowest to the highest section of the chunk
+    int min_y = INT_MAX, max_y = INT_MIN;
+    for (const Json::Value& section : chunk_sections) {
+        min_y = std::min(min_y, section["Y"].asInt());
+        max_y = std::max(max_y, section["Y"].asInt());
+    }
+    if (chunk_sections.empty())
+        min_y = max_y = 0;
+    // Chunks of the same world share their bottom section so that they line up
+    if (chunkData.isMember("yPos"))
+        min_y = std::min(min_y, chunkData["yPos"].asInt());
+    width = depth = CHUNK_SIDE_SIZE;
+    height = (max_y - min_y + 1) * SECTION_SIDE_SIZE;
+    sections = FlatLattice3D<Section>(sectionCount(width), sectionCount(height), sectionCount(depth), Section());
+
+    for (const Json::Value& section : chunk_sections)
+        loadSection(section, block_shapes, section["Y"].asInt() - min_y);
+}
+
+void SandboxScene::loadSection(const Json::Value& section, const BlockShapes& block_shapes, const int section_y) {
+    // Get the block palette for the current Y
+    const Json::Value& palette = section["palette"];
+
+    // Resolve the shape of every block in the palette, the shapes are shared with every scene using the same block shapes
     // std::cout << "PALETTE\n";//! DEBUG
-    std::vector<std::vector<AABB>> palette_shapes(palette.size(), std::vector<AABB>());
+    std::vector<ShapeId> palette_shapes(palette.size(), EMPTY_SHAPE);
+    // Each thread reuses its buffer, so lookups stop allocating once it fits the longest property set
+    thread_local std::string key;
     for (unsigned int i=0; i<palette.size(); ++i) {
         // std::cout << palette[i] << '\n';//! DEBUG
-        // Find the block in the block shapes JSON corresponding to
-        // the current block in the palette
-        const Json::Value block = shapesData[palette[i]["Name"].asString()];
-        std::string block_shape_str = "";
-
-        // If the block has properties, look for the correct shape in the block shapes JSON
-        if (palette[i].isMember("Properties")) {
-            const Json::Value block_properties = palette[i]["Properties"];
-        // std::cout << palette[i]["Properties"] << '\n';//! DEBUG
-        // std::cout << "STATES AMOUNT: " << block["states"].size() << '\n';//! DEBUG
-            for (unsigned int state_i=0; state_i<block["states"].size(); ++state_i) {
-                // std::cout << "STATE: " << state_i << '\n';//! DEBUG
-                // std::cout << block["states"][state_i]["properties"] << '\n';//! DEBUG
-                if (block["states"][state_i]["properties"] == block_properties) {
-                    block_shape_str = block["states"][state_i]["shape"].asString();
-                    break;
-                }
-            }
-        } else {
-            // Otherwise, simply select the first shape since it is the only choice
-            block_shape_str = block["states"][0]["shape"].asString();
-        }
-
-        assert(block_shape_str != "");
-        // Convert the AABB string to a vector of AABB and fill in the palette shapes
-        palette_shapes[i] = str_to_aabbvector(block_shape_str);
-        //! DEBUG
-        for (size_t j=0; j<palette_shapes[i].size(); ++j) {
-            // std::cout << palette_shapes[i][j] << '\n';
-        }
+        // Blocks without properties only have one state
+        const char* name_begin = nullptr;
+        const char* name_end = nullptr;
+        palette[i]["Name"].getString(&name_begin, &name_end);
+        canonicalProperties(palette[i]["Properties"], key);
+        const bool found = block_shapes.findShape(std::string_view(name_begin, name_end - name_begin), key,
+                                                  palette_shapes[i]);
+        assert(found);
+        (void)found;
     }
 
-    // Create the Voxel objects at correct coords
-    // voxels.resize(16, std::vector<std::vector<Voxel>>());// Y
-    if (palette.size() == 1) {
+    // Sections only get their voxels allocated once two of them have different shapes
+    Section& target = sections.at(0, section_y, 0);
+    if (palette.size() <= 1) {
         // No data for the section since the palette has only one block
-        for (int y=0; y<16; ++y) {
-            for (int z=0; z<16; ++z) {
-                // Fill with the only possible Voxel
-                for (int x=0; x<16; ++x) {
-                    for (const AABB& box : palette_shapes[0]) {
-                        voxels[y][z][x].addAABB(box);
-                    }
-                }
-                // voxels[y][z].resize(16, Voxel(palette_shapes[0]));// X
-            }
-        }
+        target = Section(palette.empty() ? EMPTY_SHAPE : palette_shapes[0]);
     } else {
         // Each block is mapped in the "data" part of the section
-        for (int y=0; y<16; ++y) {
-            for (int z=0; z<16; ++z) {
-                // voxels[y][z].resize(16);// X
-                for (int x=0; x<16; ++x) {
+        const Json::Value& data = section["data"];
+        // Indices past the palette (badly decoded sections) are considered empty
+        auto shapeOf = [&palette_shapes](const unsigned int block_id) {
+            return block_id < palette_shapes.size() ? palette_shapes[block_id] : (ShapeId)EMPTY_SHAPE;
+        };
+        target = Section(shapeOf(data[0].asUInt()));
+        for (int y=0; y<SECTION_SIDE_SIZE; ++y) {
+            for (int z=0; z<SECTION_SIDE_SIZE; ++z) {
+                for (int x=0; x<SECTION_SIDE_SIZE; ++x) {
                     // Get the block type
-                    const int block_id = sections[section_index]["data"][y*16*16+z*16+x].asInt();
-                    // Overwrite empty voxels
-                    for (const AABB& box : palette_shapes[block_id]) {
-                        voxels[y][z][x].addAABB(box);
-                    }
+                    const unsigned int block_id = data[(y*SECTION_SIDE_SIZE + z)*SECTION_SIDE_SIZE + x].asUInt();
+                    // Set the shape of the voxel
+                    target.setVoxel(x, y, z, shapeOf(block_id));
                 }
             }
         }
     }
 }
+
+bool SandboxScene::isEmpty() const {
+    for (size_t i=0; i<sections.size(); ++i)
+        if (!sections.raw()[i].isEmpty())
+            return false;
+    return true;
+}
+
+size_t SandboxScene::memoryUsage() const {
+    size_t total = sizeof(SandboxScene) + shapes->memoryUsage();
+    for (size_t i=0; i<sections.size(); ++i)
+        total += sections.raw()[i].memoryUsage();
+    return total;
+}
+
+void SandboxScene::internSections(SectionInterner& interner) {
+    for (size_t i=0; i<sections.size(); ++i)
+        interner.intern(sections.raw()[i]);
+}
+
+void SandboxScene::setVoxelLayout(const VoxelLayout layout) {
+    for (size_t i=0; i<sections.size(); ++i)
+        sections.raw()[i].setLayout(layout);
+}
@@ -0,0 +1,217 @@
+/**
+ * @file scene_file.cpp
+ */
+#include "scene_file.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <climits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scene.hpp"
+
+/**
+ * Rounds a file offset up to the next cache line.
+ */
+static uint64_t alignOffset(const uint64_t offset) {
+    return (offset + CACHE_LINE_SIZE-1) / CACHE_LINE_SIZE * CACHE_LINE_SIZE;
+}
+
+bool isSceneFile(const std::string& path) {
+    return std::filesystem::path(path).extension() == SCENE_FILE_EXTENSION;
+}
+
+/**
+ * Size in bytes of a dense section in a scene file.
+ */
+#define SCENE_FILE_DENSE_SIZE (SECTION_VOLUME*sizeof(ShapeId) + SECTION_VOLUME/64*sizeof(uint64_t))
+
+/**
+ * Stops the program on a scene file that does not match its header.
+ * @param   scenePath   File location of the binary scene file.
+ */
+[[noreturn]] static void rejectSceneFile(const std::string& scenePath) {
+    std::cout << "Bad scene file " << scenePath << ", convert the chunk again with --convert\n";
+    exit(-1);
+}
+
+/**
+ * Checks that a part of a scene file is aligned like the writer does, and lies between the end of the previous part
+ * and the start of the next one.
+ * @param   offset  Offset of the part in bytes.
+ * @param   size    Size of the part in bytes.
+ * @param   begin   End of the previous part.
+ * @param   end     Start of the next part, or size of the file.
+ * @return  True if the part is valid.
+ */
+static bool validPart(const uint64_t offset, const uint64_t size, const uint64_t begin, const uint64_t end) {
+    return offset % CACHE_LINE_SIZE == 0 && offset >= begin && offset <= end && size <= end - offset;
+}
+
+void SandboxScene::save(const std::string& scenePath) const {
+    const ShapeTable& table = *shapes;
+
+    SceneFileHeader header = {};
+    std::memcpy(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC));
+    header.version = SCENE_FILE_VERSION;
+    header.width = width;
+    header.height = height;
+    header.depth = depth;
+    header.shape_count = (uint32_t)table.size();
+    header.section_count = (uint32_t)sections.size();
+
+    // Shape table flattened back to offsets and boxes, shape 0 being the empty one
+    std::vector<uint32_t> offsets(1, 0);
+    std::vector<AABB> boxes;
+    for (size_t id=0; id<table.size(); ++id) {
+        const std::span<const AABB> shape = table.getShape((ShapeId)id);
+        boxes.insert(boxes.end(), shape.begin(), shape.end());
+        offsets.push_back((uint32_t)boxes.size());
+    }
+    header.box_count = (uint32_t)boxes.size();
+
+    // Uniform sections only take an entry in the section table
+    std::vector<uint32_t> section_table(sections.size());
+    for (size_t i=0; i<sections.size(); ++i) {
+        const Section& section = sections.raw()[i];
+        section_table[i] = section.isUniform() ? section.getUniformShape() : SCENE_FILE_DENSE_SECTION;
+        header.dense_count += !section.isUniform();
+    }
+
+    header.offsets_offset = alignOffset(sizeof(SceneFileHeader));
+    header.boxes_offset = alignOffset(header.offsets_offset + offsets.size()*sizeof(uint32_t));
+    header.sections_offset = alignOffset(header.boxes_offset + boxes.size()*sizeof(AABB));
+    header.dense_offset = alignOffset(header.sections_offset + section_table.size()*sizeof(uint32_t));
+    header.file_size = header.dense_offset + header.dense_count*SCENE_FILE_DENSE_SIZE;
+
+    std::vector<char> buffer(header.file_size, 0);
+    std::memcpy(buffer.data(), &header, sizeof(SceneFileHeader));
+    std::memcpy(buffer.data() + header.offsets_offset, offsets.data(), offsets.size()*sizeof(uint32_t));
+    std::memcpy(buffer.data() + header.boxes_offset, boxes.data(), boxes.size()*sizeof(AABB));
+    std::memcpy(buffer.data() + header.sections_offset, section_table.data(), section_table.size()*sizeof(uint32_t));
+    char* dense = buffer.data() + header.dense_offset;
+    for (size_t i=0; i<sections.size(); ++i) {
+        const Section& section = sections.raw()[i];
+        if (section.isUniform())
+            continue;
+        // Files always hold the voxels in [y][z][x] order
+        Section row_major(section);
+        row_major.setLayout(VoxelLayout::ROW_MAJOR);
+        std::memcpy(dense, row_major.rawVoxels(), SECTION_VOLUME*sizeof(ShapeId));
+        std::memcpy(dense + SECTION_VOLUME*sizeof(ShapeId), row_major.rawOccupancy(), SECTION_VOLUME/64*sizeof(uint64_t));
+        dense += SCENE_FILE_DENSE_SIZE;
+    }
+
+    std::ofstream output(scenePath, std::ios_base::out | std::ios_base::binary);
+    output.write(buffer.data(), buffer.size());
+    if (!output) {
+        std::cout << "Could not write the scene file " << scenePath << '\n';
+        exit(-1);
+    }
+}
+
+SandboxScene::SandboxScene(const std::string& scenePath)
+: width(0), height(0), depth(0), sections(), shapes(), scene_revision(nextSceneRevision()) {
+    const int fd = open(scenePath.c_str(), O_RDONLY);
+    struct stat file_stat;
+    if (fd < 0 || fstat(fd, &file_stat) < 0 || (size_t)file_stat.st_size < sizeof(SceneFileHeader)) {
+        std::cout << "Could not open the scene file " << scenePath << '\n';
+        exit(-1);
+    }
+    const size_t file_size = file_stat.st_size;
+    void* mapping = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        std::cout << "Could not map the scene file " << scenePath << '\n';
+        exit(-1);
+    }
+    const char* data = static_cast<const char*>(mapping);
+
+    SceneFileHeader header;
+    std::memcpy(&header, data, sizeof(SceneFileHeader));
+    // Dimensions are checked first so that the section counts can not wrap
+    for (const uint32_t size : {header.width, header.height, header.depth})
+        if (size == 0 || size > (uint32_t)(INT_MAX - SECTION_SIDE_SIZE))
+            rejectSceneFile(scenePath);
+    const int sections_x = (header.width + SECTION_SIDE_SIZE-1) / SECTION_SIDE_SIZE;
+    const int sections_y = (header.height + SECTION_SIDE_SIZE-1) / SECTION_SIDE_SIZE;
+    const int sections_z = (header.depth + SECTION_SIDE_SIZE-1) / SECTION_SIDE_SIZE;
+    // Every part must lie in the file after the previous one, so that nothing is read out of the mapping
+    if (std::memcmp(header.magic, SCENE_FILE_MAGIC, sizeof(SCENE_FILE_MAGIC))
+        || header.version != SCENE_FILE_VERSION || header.file_size != file_size
+        || header.section_count != (uint64_t)sections_x*sections_y*sections_z
+        || header.shape_count == 0 || header.shape_count > (uint64_t)std::numeric_limits<ShapeId>::max() + 1
+        || header.dense_count > header.section_count
+        || !validPart(header.offsets_offset, ((uint64_t)header.shape_count + 1)*sizeof(uint32_t),
+                      sizeof(SceneFileHeader), header.boxes_offset)
+        || !validPart(header.boxes_offset, (uint64_t)header.box_count*sizeof(AABB),
+                      header.offsets_offset, header.sections_offset)
+        || !validPart(header.sections_offset, (uint64_t)header.section_count*sizeof(uint32_t),
+                      header.boxes_offset, header.dense_offset)
+        || !validPart(header.dense_offset, header.dense_count*SCENE_FILE_DENSE_SIZE, header.sections_offset, file_size))
+        rejectSceneFile(scenePath);
+
+    // Shape offsets must be increasing and end with the boxes, shape 0 being the empty one
+    const uint32_t* offsets = reinterpret_cast<const uint32_t*>(data + header.offsets_offset);
+    const AABB* boxes = reinterpret_cast<const AABB*>(data + header.boxes_offset);
+    if (offsets[0] != 0 || offsets[1] != 0 || offsets[header.shape_count] != header.box_count)
+        rejectSceneFile(scenePath);
+    for (uint32_t id=1; id<header.shape_count; ++id)
+        if (offsets[id] > offsets[id+1])
+            rejectSceneFile(scenePath);
+
+    // Shapes are interned in file order so that their identifiers are kept, the file holding each shape once
+    auto table = std::make_shared<ShapeTable>();
+    for (uint32_t id=1; id<header.shape_count; ++id)
+        if (table->intern(std::span<const AABB>(boxes + offsets[id], offsets[id+1] - offsets[id])) != id)
+            rejectSceneFile(scenePath);
+    shapes = std::move(table);
+
+    // Dense sections are copied as is
+    width = header.width;
+    height = header.height;
+    depth = header.depth;
+    sections = FlatLattice3D<Section>(sections_x, sections_y, sections_z, Section());
+    const uint32_t* section_table = reinterpret_cast<const uint32_t*>(data + header.sections_offset);
+    const char* dense = data + header.dense_offset;
+    uint32_t dense_count = 0;
+    for (size_t i=0; i<sections.size(); ++i) {
+        Section& section = sections.raw()[i];
+        if (section_table[i] != SCENE_FILE_DENSE_SECTION) {
+            if (section_table[i] >= header.shape_count)
+                rejectSceneFile(scenePath);
+            section = Section((ShapeId)section_table[i]);
+            continue;
+        }
+        if (++dense_count > header.dense_count)
+            rejectSceneFile(scenePath);
+        const ShapeId* voxels = reinterpret_cast<const ShapeId*>(dense);
+        if (std::any_of(voxels, voxels + SECTION_VOLUME, [&header](const ShapeId id) { return id >= header.shape_count; }))
+            rejectSceneFile(scenePath);
+        // Traversals trust the occupancy bits, they must be set exactly for the voxels that are not empty
+        const uint64_t* occupancy = reinterpret_cast<const uint64_t*>(dense + SECTION_VOLUME*sizeof(ShapeId));
+        for (int w=0; w<SECTION_VOLUME/64; ++w) {
+            uint64_t word = 0;
+            for (int b=0; b<64; ++b)
+                word |= (uint64_t)(voxels[w*64 + b] != EMPTY_SHAPE) << b;
+            if (word != occupancy[w])
+                rejectSceneFile(scenePath);
+        }
+        section.expand();
+        std::memcpy(section.rawVoxels(), dense, SECTION_VOLUME*sizeof(ShapeId));
+        std::memcpy(section.rawOccupancy(), dense + SECTION_VOLUME*sizeof(ShapeId), SECTION_VOLUME/64*sizeof(uint64_t));
+        dense += SCENE_FILE_DENSE_SIZE;
+    }
+    if (dense_count != header.dense_count)
+        rejectSceneFile(scenePath);
+
+    munmap(mapping, file_size);
+}
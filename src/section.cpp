@@ -0,0 +1,176 @@
+/**
+ * @file section.cpp
+ */
+#include "section.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <string_view>
+
+/**
+ * Counters returned by Section::getMaterializationStats, updated by every thread.
+ */
+static std::atomic<uint64_t> materialized_sections(0);
+static std::atomic<uint64_t> materialize_nanoseconds(0);
+
+
+Section::Section(std::vector<ShapeId> palette, std::vector<uint64_t> words, const int bits, const bool lazy)
+: uniform(EMPTY_SHAPE), dense(), voxel_data(nullptr), occupancy_data(nullptr), packed(),
+  layout(VoxelLayout::ROW_MAJOR) {
+    if (!lazy) {
+        unpack(palette, words.data(), bits);
+        return;
+    }
+    packed = std::make_unique<PackedVoxels>();
+    packed->palette = std::move(palette);
+    packed->words = std::move(words);
+    packed->bits = bits;
+    packed->ready.store(false, std::memory_order_relaxed);
+}
+
+Section::Section(const Section& other)
+: uniform(other.uniform), dense(other.dense), voxel_data(other.voxel_data), occupancy_data(other.occupancy_data),
+  packed(), layout(other.layout) {
+    if (other.isPacked()) {
+        packed = std::make_unique<PackedVoxels>();
+        packed->palette = other.packed->palette;
+        packed->words = other.packed->words;
+        packed->bits = other.packed->bits;
+        packed->ready.store(false, std::memory_order_relaxed);
+    }
+}
+
+Section& Section::operator=(const Section& other) {
+    if (this != &other)
+        *this = Section(other);
+    return *this;
+}
+
+Section::Section(Section&& other) noexcept
+: uniform(other.uniform), dense(std::move(other.dense)), voxel_data(other.voxel_data),
+  occupancy_data(other.occupancy_data), packed(std::move(other.packed)), layout(other.layout) {
+    other.refreshData();
+}
+
+Section& Section::operator=(Section&& other) noexcept {
+    if (this != &other) {
+        uniform = other.uniform;
+        dense = std::move(other.dense);
+        packed = std::move(other.packed);
+        layout = other.layout;
+        refreshData();
+        other.refreshData();
+    }
+    return *this;
+}
+
+void Section::allocate() const {
+    dense = std::make_shared<DenseVoxels>();
+    dense->voxels = FlatLattice3D<ShapeId>(SECTION_SIDE_SIZE, SECTION_SIDE_SIZE, SECTION_SIDE_SIZE, uniform);
+    dense->occupancy = OccupancyMask(SECTION_VOLUME);
+    dense->layout = layout;
+    if (uniform != EMPTY_SHAPE)
+        for (size_t i=0; i<SECTION_VOLUME; ++i)
+            dense->occupancy.set(i, true);
+    refreshData();
+}
+
+void Section::unshare() const {
+    if (dense && dense.use_count() > 1) {
+        dense = std::make_shared<DenseVoxels>(*dense);
+        refreshData();
+    }
+}
+
+void Section::setLayout(const VoxelLayout target) {
+    if (target == layout)
+        return;
+    // Packed and uniform sections only have to remember the order
+    if (dense) {
+        auto converted = std::make_shared<DenseVoxels>();
+        converted->voxels = FlatLattice3D<ShapeId>(SECTION_SIDE_SIZE, SECTION_SIDE_SIZE, SECTION_SIDE_SIZE);
+        converted->occupancy = OccupancyMask(SECTION_VOLUME);
+        converted->layout = target;
+        for (int y=0; y<SECTION_SIDE_SIZE; ++y) {
+            for (int z=0; z<SECTION_SIDE_SIZE; ++z) {
+                for (int x=0; x<SECTION_SIDE_SIZE; ++x) {
+                    const size_t from = index(x, y, z, layout), to = index(x, y, z, target);
+                    converted->voxels.raw()[to] = dense->voxels.raw()[from];
+                    converted->occupancy.set(to, dense->occupancy.test(from));
+                }
+            }
+        }
+        dense = std::move(converted);
+        refreshData();
+    }
+    layout = target;
+}
+
+void Section::unpack(const std::vector<ShapeId>& palette, const uint64_t* words, const int bits) const {
+    auto shapeOf = [&palette](const uint64_t index) {
+        return index < palette.size() ? palette[index] : (ShapeId)EMPTY_SHAPE;
+    };
+    const int per_word = 64 / bits;
+    const uint64_t mask = (1ull << bits) - 1;
+
+    // Indices are in [y][z][x] order, storeVoxel places them in the layout of the section
+    dense.reset();
+    refreshData();
+    uniform = shapeOf(words[0] & mask);
+    int i = 0;
+    for (size_t w=0; i<SECTION_VOLUME; ++w) {
+        uint64_t word = words[w];
+        for (int k=0; k<per_word && i<SECTION_VOLUME; ++k, ++i, word >>= bits)
+            storeVoxel(i % SECTION_SIDE_SIZE, i / (SECTION_SIDE_SIZE*SECTION_SIDE_SIZE),
+                       (i / SECTION_SIDE_SIZE) % SECTION_SIDE_SIZE, shapeOf(word & mask));
+    }
+}
+
+void Section::materializeSlow() const {
+    std::call_once(packed->once, [this] {
+        const auto t_start = std::chrono::steady_clock::now();
+        unpack(packed->palette, packed->words.data(), packed->bits);
+        // Only this thread reads the packed indices, the others wait on once or read ready
+        std::vector<ShapeId>().swap(packed->palette);
+        std::vector<uint64_t>().swap(packed->words);
+        packed->ready.store(true, std::memory_order_release);
+        const auto t_end = std::chrono::steady_clock::now();
+
+        materialized_sections.fetch_add(1, std::memory_order_relaxed);
+        materialize_nanoseconds.fetch_add(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(t_end - t_start).count(), std::memory_order_relaxed);
+    });
+}
+
+MaterializationStats Section::getMaterializationStats() {
+    return {materialized_sections.load(std::memory_order_relaxed), materialize_nanoseconds.load(std::memory_order_relaxed)};
+}
+
+SectionInterner::SectionInterner()
+: blocks(), stats({0, 0, 0}) {}
+
+void SectionInterner::intern(Section& section) {
+    if (section.isPacked() || !section.dense)
+        return;
+    ++stats.dense_sections;
+    const DenseVoxels& voxels = *section.dense;
+    const size_t voxel_bytes = voxels.voxels.size()*sizeof(ShapeId);
+    const uint64_t hash = std::hash<std::string_view>()(
+        std::string_view(reinterpret_cast<const char*>(voxels.voxels.raw()), voxel_bytes));
+
+    std::vector<std::shared_ptr<DenseVoxels>>& candidates = blocks[hash];
+    for (const std::shared_ptr<DenseVoxels>& block : candidates) {
+        if (block == section.dense)
+            return;
+        if (block->layout == voxels.layout
+            && std::memcmp(block->voxels.raw(), voxels.voxels.raw(), voxel_bytes) == 0) {
+            if (section.dense.use_count() == 1)
+                stats.saved_bytes += sizeof(DenseVoxels) + voxel_bytes + voxels.occupancy.memoryUsage();
+            section.dense = block;
+            section.refreshData();
+            return;
+        }
+    }
+    candidates.push_back(section.dense);
+    ++stats.distinct_sections;
+}
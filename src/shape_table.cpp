@@ -0,0 +1,77 @@
+/**
+ * @file shape_table.cpp
+ */
+#include "shape_table.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <limits>
+
+
+/**
+ * Computes the sub-voxel mask of a shape, see ShapeTable::getSubvoxelMask.
+ * @param   shape   Boxes of the shape.
+ * @return  One bit per cell touching a box.
+ */
+static uint64_t computeSubvoxelMask(std::span<const AABB> shape) {
+    uint64_t mask = 0;
+    for (const AABB& box : shape) {
+        int low[3], high[3];
+        for (int axis=0; axis<3; ++axis) {
+            // Boxes reaching out of the voxel can be hit by rays that never cross them inside of it
+            if (box.min[axis] < 0. || box.max[axis] > 1.)
+                return ~(uint64_t)0;
+            // Cells sharing a face with the box are kept so that hits on a cell boundary are not lost
+            low[axis] = std::max(0, (int)std::ceil(box.min[axis]*SUBVOXEL_SIDE) - 1);
+            high[axis] = std::min(SUBVOXEL_SIDE-1, (int)std::floor(box.max[axis]*SUBVOXEL_SIDE));
+        }
+        for (int y=low[1]; y<=high[1]; ++y)
+            for (int z=low[2]; z<=high[2]; ++z)
+                for (int x=low[0]; x<=high[0]; ++x)
+                    mask |= (uint64_t)1 << ((y*SUBVOXEL_SIDE + z)*SUBVOXEL_SIDE + x);
+    }
+    return mask;
+}
+
+ShapeTable::ShapeTable()
+: boxes(), offsets({0, 0}), soa(), block_offsets({0, 0}), subvoxel_masks({0}), lookup({{"", EMPTY_SHAPE}}) {}
+
+ShapeId ShapeTable::intern(std::span<const AABB> shape) {
+    const std::string key(reinterpret_cast<const char*>(shape.data()), shape.size()*sizeof(AABB));
+
+    auto found = lookup.find(key);
+    if (found != lookup.end())
+        return found->second;
+
+    assert(size() < std::numeric_limits<ShapeId>::max());
+    const ShapeId id = (ShapeId)size();
+    boxes.insert(boxes.end(), shape.begin(), shape.end());
+    offsets.push_back((uint32_t)boxes.size());
+
+    // SoA copy, box i goes in lane i%SHAPE_BLOCK_WIDTH of block i/SHAPE_BLOCK_WIDTH
+    const size_t block_count = (shape.size()+SHAPE_BLOCK_WIDTH-1)/SHAPE_BLOCK_WIDTH;
+    const size_t first = soa.size();
+    soa.resize(first + block_count*SHAPE_BLOCK_SIZE, 0.);
+    for (size_t i=0; i<shape.size(); ++i) {
+        double* block = soa.data() + first + (i/SHAPE_BLOCK_WIDTH)*SHAPE_BLOCK_SIZE;
+        const size_t lane = i%SHAPE_BLOCK_WIDTH;
+        for (int axis=0; axis<3; ++axis) {
+            block[axis*SHAPE_BLOCK_WIDTH + lane] = shape[i].min[axis];
+            block[(axis+3)*SHAPE_BLOCK_WIDTH + lane] = shape[i].max[axis];
+        }
+    }
+    block_offsets.push_back(block_offsets.back() + (uint32_t)block_count);
+    subvoxel_masks.push_back(computeSubvoxelMask(shape));
+    lookup.emplace(key, id);
+    return id;
+}
+
+size_t ShapeTable::memoryUsage() const {
+    size_t total = boxes.capacity()*sizeof(AABB) + offsets.capacity()*sizeof(uint32_t)
+        + soa.capacity()*sizeof(double) + block_offsets.capacity()*sizeof(uint32_t)
+        + subvoxel_masks.capacity()*sizeof(uint64_t);
+    for (const auto& entry : lookup)
+        total += entry.first.capacity() + sizeof(entry);
+    return total;
+}
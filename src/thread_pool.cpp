@@ -0,0 +1,58 @@
+/**
+ * @file thread_pool.cpp
+ */
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+
+ThreadPool::ThreadPool(const int thread_count)
+: workers(), tasks(), pending(0), stopping(false) {
+    for (int w=0; w<std::max(1, thread_count); ++w)
+        workers.emplace_back(&ThreadPool::workerLoop, this, w);
+}
+
+ThreadPool::~ThreadPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    task_queued.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void ThreadPool::workerLoop(const int worker) {
+    while (true) {
+        std::function<void(int)> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            task_queued.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())
+                return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task(worker);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0)
+                tasks_done.notify_all();
+        }
+    }
+}
+
+void ThreadPool::submit(std::function<void(int)> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+        ++pending;
+    }
+    task_queued.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    tasks_done.wait(lock, [this] { return pending == 0; });
+}
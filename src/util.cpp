@@ -3,6 +3,8 @@
  */
 #include "util.hpp"
 
+#include <charconv>
+
 #include <polyscope/surface_mesh.h>
 #include <polyscope/curve_network.h>
 
@@ -64,6 +66,39 @@ std::vector<AABB> str_to_aabbvector(const std::string& s) {
     return output;
 }
 
+bool str_to_aabbs(std::string_view s, std::vector<AABB>& output) {
+    output.clear();
+    const char* curr = s.data();
+    const char* const end = s.data() + s.size();
+
+    // Consumes an expected token
+    auto skip = [&curr, end](std::string_view token) {
+        if ((size_t)(end - curr) < token.size() || std::string_view(curr, token.size()) != token)
+            return false;
+        curr += token.size();
+        return true;
+    };
+    // Consumes a coordinate
+    auto number = [&curr, end](double& value) {
+        const auto [next, error] = std::from_chars(curr, end, value);
+        curr = next;
+        return error == std::errc();
+    };
+
+    if (!skip("["))
+        return false;
+    while (curr != end && *curr != ']') {
+        double x_min, y_min, z_min, x_max, y_max, z_max;
+        if (!(skip("AABB[") && number(x_min) && skip(", ") && number(y_min) && skip(", ") && number(z_min)
+              && skip("] -> [") && number(x_max) && skip(", ") && number(y_max) && skip(", ") && number(z_max)
+              && skip("]")))
+            return false;
+        output.emplace_back(x_min, y_min, z_min, x_max, y_max, z_max);
+        skip(", ");
+    }
+    return skip("]");
+}
+
 void createSceneMeshes(const SandboxScene& scene, const std::string& name) {
     // Cube faces to make a correctly oriented cube given arrays of vertices
     std::vector<Face> box_faces({
@@ -78,9 +113,9 @@ void createSceneMeshes(const SandboxScene& scene, const std::string& name) {
     unsigned int cube_counter = 0;
 
     // Test scene
-    for (int x=0; x<CHUNK_SIDE_SIZE; ++x) {
-        for (int y=0; y<CHUNK_SIDE_SIZE; ++y) {
-            for (int z=0; z<CHUNK_SIDE_SIZE; ++z) {
+    for (int x=0; x<scene.sizeX(); ++x) {
+        for (int y=0; y<scene.sizeY(); ++y) {
+            for (int z=0; z<scene.sizeZ(); ++z) {
                 for (AABB box : scene.getVoxel(VoxelPosition(x,y,z))) {
                     /* 1x1x1 cube: {
                      {0.,0.,0.},
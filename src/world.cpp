@@ -0,0 +1,219 @@
+/**
+ * @file world.cpp
+ */
+#include "world.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <iostream>
+#include <optional>
+
+#include <json/json.h>
+
+#include "region.hpp"
+#include "chunk_cache.hpp"
+
+
+/**
+ * Chunk to load: a chunk of a region file, or a whole chunk JSON file.
+ */
+struct ChunkJob {
+    /**
+     * Index of the file in the sorted file list.
+     */
+    size_t file;
+    /**
+     * Index of the chunk in the region file, -1 for chunk JSON files.
+     */
+    int chunk;
+};
+
+World::World(const std::string& worldPath, const BlockShapes& block_shapes, ThreadPool& pool,
+             const bool lazy_sections, const size_t cache_budget, const bool dedup_sections,
+             const VoxelLayout voxel_layout)
+: chunks(), origin({0, 0}), chunks_x(0), chunks_z(0), height(0), index(), shapes(block_shapes.getShapeTable()),
+  empty_chunks(0), cache(), cached_slot(SIZE_MAX), cached_chunk(nullptr),
+  dedup_stats({0, 0, 0}), world_revision(nextSceneRevision()) {
+    // Sorted so that the chunks are always read in the same order
+    std::vector<std::filesystem::path> chunk_paths;
+    if (std::filesystem::is_directory(worldPath)) {
+        for (const auto& entry : std::filesystem::directory_iterator(worldPath))
+            if (entry.is_regular_file() && (entry.path().extension() == ".json" || isRegionFile(entry.path())))
+                chunk_paths.push_back(entry.path());
+        std::sort(chunk_paths.begin(), chunk_paths.end());
+    } else {
+        chunk_paths.push_back(worldPath);
+    }
+
+    // Region headers are read up front so that every chunk is a job of its own
+    std::vector<std::unique_ptr<RegionFile>> regions(chunk_paths.size());
+    std::vector<ChunkJob> jobs;
+    for (size_t f=0; f<chunk_paths.size(); ++f) {
+        if (!isRegionFile(chunk_paths[f])) {
+            jobs.push_back({f, -1});
+            continue;
+        }
+        regions[f] = std::make_unique<RegionFile>(chunk_paths[f]);
+        for (int i=0; i<REGION_CHUNK_COUNT; ++i)
+            if (regions[f]->hasChunk(i))
+                jobs.push_back({f, i});
+    }
+
+    // Each worker decodes with its own buffers, chunks that could not be read keep a height of -1
+    // A streaming world drops the chunks once they are placed, rays read them again through the cache
+    const bool streaming = cache_budget > 0;
+    std::vector<ChunkDecoder> decoders(pool.size(), ChunkDecoder(lazy_sections));
+    std::vector<ChunkPosition> positions(jobs.size(), {0, 0});
+    std::vector<int> heights(jobs.size(), -1);
+    std::vector<uint8_t> empty(jobs.size(), 0);
+    std::vector<std::optional<SandboxScene>> decoded(jobs.size());
+    auto keep = [&](const size_t j, SandboxScene&& chunk) {
+        heights[j] = chunk.sizeY();
+        empty[j] = chunk.isEmpty();
+        if (!streaming)
+            decoded[j].emplace(std::move(chunk));
+    };
+    pool.parallelFor(jobs.size(), [&](const size_t j, const int worker) {
+        const ChunkJob& job = jobs[j];
+        if (job.chunk < 0) {
+            // Other JSON files of the folder (block shapes...) are not chunks and are skipped like unreadable ones
+            Json::Value chunkData;
+            if (!readChunkFile(chunk_paths[job.file], block_shapes, chunkData))
+                return;
+            positions[j] = {chunkData["xPos"].asInt(), chunkData["zPos"].asInt()};
+            keep(j, SandboxScene(chunkData, block_shapes));
+            return;
+        }
+        SandboxScene chunk(0, 0, 0, shapes);
+        if (decoders[worker].readChunk(*regions[job.file], job.chunk, block_shapes, positions[j], chunk))
+            keep(j, std::move(chunk));
+    });
+
+    // Chunks are published in the order of the files so that the world does not depend on the scheduling
+    // Interning follows the same order, the first chunk holding a section keeps its copy
+    std::unordered_map<ChunkPosition, ChunkSource, ChunkPositionHash> streamed;
+    SectionInterner interner;
+    for (size_t j=0; j<jobs.size(); ++j) {
+        if (heights[j] < 0) {
+            if (jobs[j].chunk < 0)
+                std::cout << "[!] Could not read the chunk file " << chunk_paths[jobs[j].file].string() << '\n';
+            else
+                std::cout << "[!] Could not read the chunk " << jobs[j].chunk % REGION_SIDE_CHUNKS << ' '
+                          << jobs[j].chunk / REGION_SIDE_CHUNKS << " of the region file "
+                          << chunk_paths[jobs[j].file].string() << '\n';
+            continue;
+        }
+        if (!placeChunk(positions[j], empty[j], heights[j]))
+            continue;
+        if (streaming) {
+            streamed.insert_or_assign(positions[j], ChunkSource{(int)jobs[j].file, jobs[j].chunk});
+        } else {
+            decoded[j]->setVoxelLayout(voxel_layout);
+            if (dedup_sections)
+                decoded[j]->internSections(interner);
+            chunks.insert_or_assign(positions[j], std::move(*decoded[j]));
+            decoded[j].reset();
+        }
+    }
+
+    if (!streaming) {
+        dedup_stats = interner.getStats();
+        buildIndex();
+        return;
+    }
+    std::unordered_map<size_t, ChunkSource> sources;
+    sources.reserve(streamed.size());
+    for (const auto& [position, source] : streamed)
+        sources.emplace((size_t)(position.z - origin.z)*chunks_x + (position.x - origin.x), source);
+    regions.clear();
+    cache = std::make_unique<ChunkCache>(std::move(chunk_paths), sources, block_shapes, chunks_x, chunks_z,
+                                         cache_budget, lazy_sections, voxel_layout);
+}
+
+World::~World() = default;
+
+const SandboxScene* World::fetchChunk(const size_t slot) const {
+    return cache->fetch(slot);
+}
+
+bool World::placeChunk(const ChunkPosition& position, const bool empty, const int chunk_height) {
+    if (chunks_x == 0) {
+        origin = position;
+        chunks_x = chunks_z = 1;
+    }
+
+    // Empty chunks still extend the world so that rays are shot over them
+    const ChunkPosition far_corner = {std::max(origin.x + chunks_x - 1, position.x),
+                                      std::max(origin.z + chunks_z - 1, position.z)};
+    origin = {std::min(origin.x, position.x), std::min(origin.z, position.z)};
+    chunks_x = far_corner.x - origin.x + 1;
+    chunks_z = far_corner.z - origin.z + 1;
+
+    if (empty) {
+        ++empty_chunks;
+        return false;
+    }
+    if (height == 0) {
+        height = chunk_height;
+    } else if (chunk_height != height) {
+        std::cout << "Chunk " << position.x << ' ' << position.z << " is " << chunk_height
+                  << " voxels high instead of " << height << '\n';
+        exit(-1);
+    }
+    return true;
+}
+
+const SandboxScene* World::findChunk(const size_t slot) const {
+    // Several threads trace a world that is not streaming, the revision tells the worlds apart
+    thread_local uint64_t memo_revision = 0;
+    thread_local size_t memo_slot = SIZE_MAX;
+    thread_local const SandboxScene* memo_chunk = nullptr;
+    if (memo_revision != world_revision || memo_slot != slot) {
+        const auto chunk = chunks.find({origin.x + (int)(slot % chunks_x), origin.z + (int)(slot / chunks_x)});
+        memo_chunk = chunk == chunks.end() ? nullptr : &chunk->second;
+        memo_revision = world_revision;
+        memo_slot = slot;
+    }
+    return memo_chunk;
+}
+
+void World::buildIndex() {
+    // Chunks far apart would make the table huge, sparse worlds hash instead
+    index.clear();
+    if (chunks.size()*WORLD_DENSE_INDEX_RATIO < (size_t)chunks_x*chunks_z)
+        return;
+    index.assign((size_t)chunks_x*chunks_z, nullptr);
+    for (const auto& [position, chunk] : chunks)
+        index[(size_t)(position.z - origin.z)*chunks_x + (position.x - origin.x)] = &chunk;
+}
+
+size_t World::chunkCount() const {
+    return cache ? cache->chunkCount() : chunks.size();
+}
+
+ChunkCacheStats World::cacheStats() const {
+    return cache ? cache->getStats() : ChunkCacheStats{0, 0, 0, 0, 0, 0, 0, 0};
+}
+
+size_t World::packedSectionCount() const {
+    size_t count = 0;
+    auto countPacked = [&count](const SandboxScene& chunk) {
+        const FlatLattice3D<Section>& sections = chunk.getSections();
+        for (size_t i=0; i<sections.size(); ++i)
+            count += sections.raw()[i].isPacked();
+    };
+    for (const auto& [position, chunk] : chunks)
+        countPacked(chunk);
+    if (cache)
+        cache->forEachResident(countPacked);
+    return count;
+}
+
+size_t World::memoryUsage() const {
+    size_t total = sizeof(World) + index.capacity()*sizeof(const SandboxScene*) + shapes->memoryUsage();
+    if (cache)
+        total += sizeof(ChunkCache) + cache->getStats().resident_bytes;
+    for (const auto& [position, chunk] : chunks)
+        total += chunk.memoryUsage() - chunk.getShapes().memoryUsage() + sizeof(position);
+    return total;
+}